@@ -372,6 +372,8 @@ static struct apartment *apartment_construct(DWORD model)
 
     list_init(&apt->proxies);
     list_init(&apt->stubmgrs);
+    wine_rb_init(&apt->stubmgrs_by_oid, stub_manager_oid_compare);
+    wine_rb_init(&apt->ifstubs_by_ipid, ifstub_ipid_compare);
     list_init(&apt->loaded_dlls);
     list_init(&apt->usage_cookies);
     apt->ipidc = 0;
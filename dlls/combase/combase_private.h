@@ -19,6 +19,7 @@
 
 #include "wine/heap.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 
 extern HINSTANCE hProxyDll;
 
@@ -34,6 +35,8 @@ struct apartment
     CRITICAL_SECTION cs;     /* thread safety */
     struct list proxies;     /* imported objects (CS cs) */
     struct list stubmgrs;    /* stub managers for exported objects (CS cs) */
+    struct wine_rb_tree stubmgrs_by_oid; /* stub managers indexed by OID (CS cs) */
+    struct wine_rb_tree ifstubs_by_ipid; /* interface stubs of all stub managers indexed by IPID (CS cs) */
     BOOL remunk_exported;    /* has the IRemUnknown interface for this apartment been created yet? (CS cs) */
     LONG remoting_started;   /* has the RPC system been started for this apartment? (LOCK) */
     struct list loaded_dlls; /* list of dlls loaded by this apartment (CS cs) */
@@ -206,6 +209,8 @@ typedef enum ifstub_state
 struct ifstub
 {
     struct list       entry;      /* entry in stub_manager->ifstubs list (CS stub_manager->lock) */
+    struct wine_rb_entry ipid_entry; /* entry in apartment ifstubs_by_ipid tree (CS apt->cs) */
+    struct stub_manager *manager; /* owning stub manager (RO) */
     IRpcStubBuffer   *stubbuffer; /* RO */
     IID               iid;        /* RO */
     IPID              ipid;       /* RO */
@@ -218,6 +223,7 @@ struct ifstub
 struct stub_manager
 {
     struct list       entry;      /* entry in apartment stubmgr list (CS apt->cs) */
+    struct wine_rb_entry oid_entry; /* entry in apartment stubmgrs_by_oid tree (CS apt->cs) */
     struct list       ifstubs;    /* list of active ifstubs for the object (CS lock) */
     CRITICAL_SECTION  lock;
     struct apartment *apt;        /* owning apt (RO) */
@@ -243,6 +249,8 @@ struct stub_manager
 };
 
 ULONG stub_manager_int_release(struct stub_manager *stub_manager) DECLSPEC_HIDDEN;
+int stub_manager_oid_compare(const void *key, const struct wine_rb_entry *entry) DECLSPEC_HIDDEN;
+int ifstub_ipid_compare(const void *key, const struct wine_rb_entry *entry) DECLSPEC_HIDDEN;
 struct stub_manager * get_stub_manager_from_object(struct apartment *apt, IUnknown *object, BOOL alloc) DECLSPEC_HIDDEN;
 void stub_manager_disconnect(struct stub_manager *m) DECLSPEC_HIDDEN;
 ULONG stub_manager_ext_addref(struct stub_manager *m, ULONG refs, BOOL tableweak) DECLSPEC_HIDDEN;
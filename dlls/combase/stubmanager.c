@@ -44,6 +44,23 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(ole);
 
+int stub_manager_oid_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct stub_manager *m = WINE_RB_ENTRY_VALUE(entry, const struct stub_manager, oid_entry);
+    OID oid = *(const OID *)key;
+
+    if (oid > m->oid) return 1;
+    if (oid < m->oid) return -1;
+    return 0;
+}
+
+int ifstub_ipid_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct ifstub *ifstub = WINE_RB_ENTRY_VALUE(entry, const struct ifstub, ipid_entry);
+
+    return memcmp(key, &ifstub->ipid, sizeof(IPID));
+}
+
 /* generates an ipid in the following format (similar to native version):
  * Data1 = apartment-local ipid counter
  * Data2 = apartment creator thread ID
@@ -98,6 +115,7 @@ struct ifstub * stub_manager_new_ifstub(struct stub_manager *m, IRpcStubBuffer *
     stub->stubbuffer = sb;
     if (sb) IRpcStubBuffer_AddRef(sb);
 
+    stub->manager = m;
     stub->flags = flags;
     stub->iid = *iid;
 
@@ -108,11 +126,15 @@ struct ifstub * stub_manager_new_ifstub(struct stub_manager *m, IRpcStubBuffer *
     else
         generate_ipid(m, &stub->ipid);
 
+    EnterCriticalSection(&m->apt->cs);
     EnterCriticalSection(&m->lock);
     list_add_head(&m->ifstubs, &stub->entry);
+    if (wine_rb_put(&m->apt->ifstubs_by_ipid, &stub->ipid, &stub->ipid_entry))
+        WARN("ipid %s is already in use\n", debugstr_guid(&stub->ipid));
     /* every normal marshal is counted so we don't allow more than we should */
     if (flags & MSHLFLAGS_NORMAL) m->norm_refs++;
     LeaveCriticalSection(&m->lock);
+    LeaveCriticalSection(&m->apt->cs);
 
     TRACE("ifstub %p created with ipid %s\n", stub, debugstr_guid(&stub->ipid));
 
@@ -135,20 +157,23 @@ static void stub_manager_delete_ifstub(struct stub_manager *m, struct ifstub *if
     HeapFree(GetProcessHeap(), 0, ifstub);
 }
 
+/* caller must hold apt->cs */
+static struct ifstub *apartment_ipid_to_ifstub(struct apartment *apt, const IPID *ipid)
+{
+    struct wine_rb_entry *entry;
+
+    if (!(entry = wine_rb_get(&apt->ifstubs_by_ipid, ipid))) return NULL;
+    return WINE_RB_ENTRY_VALUE(entry, struct ifstub, ipid_entry);
+}
+
 static struct ifstub *stub_manager_ipid_to_ifstub(struct stub_manager *m, const IPID *ipid)
 {
-    struct ifstub *result = NULL, *ifstub;
+    struct ifstub *result;
 
-    EnterCriticalSection(&m->lock);
-    LIST_FOR_EACH_ENTRY(ifstub, &m->ifstubs, struct ifstub, entry)
-    {
-        if (IsEqualGUID(ipid, &ifstub->ipid))
-        {
-            result = ifstub;
-            break;
-        }
-    }
-    LeaveCriticalSection(&m->lock);
+    EnterCriticalSection(&m->apt->cs);
+    if ((result = apartment_ipid_to_ifstub(m->apt, ipid)) && result->manager != m)
+        result = NULL;
+    LeaveCriticalSection(&m->apt->cs);
 
     return result;
 }
@@ -232,6 +257,7 @@ static struct stub_manager *new_stub_manager(struct apartment *apt, IUnknown *ob
     EnterCriticalSection(&apt->cs);
     sm->oid = apt->oidc++;
     list_add_head(&apt->stubmgrs, &sm->entry);
+    wine_rb_put(&apt->stubmgrs_by_oid, &sm->oid, &sm->oid_entry);
     LeaveCriticalSection(&apt->cs);
 
     TRACE("Created new stub manager (oid=%s) at %p for object with IUnknown %p\n", wine_dbgstr_longlong(sm->oid), sm, object);
@@ -318,7 +344,17 @@ ULONG stub_manager_int_release(struct stub_manager *m)
 
     /* remove from apartment so no other thread can access it... */
     if (!refs)
+    {
+        struct ifstub *ifstub;
+
         list_remove(&m->entry);
+        wine_rb_remove(&apt->stubmgrs_by_oid, &m->oid_entry);
+        LIST_FOR_EACH_ENTRY(ifstub, &m->ifstubs, struct ifstub, entry)
+        {
+            if (apartment_ipid_to_ifstub(apt, &ifstub->ipid) == ifstub)
+                wine_rb_remove(&apt->ifstubs_by_ipid, &ifstub->ipid_entry);
+        }
+    }
 
     LeaveCriticalSection(&apt->cs);
 
@@ -380,17 +416,14 @@ struct stub_manager * get_stub_manager_from_object(struct apartment *apt, IUnkno
  * it must also call release on the stub manager when it is no longer needed */
 struct stub_manager * get_stub_manager(struct apartment *apt, OID oid)
 {
-    struct stub_manager *result = NULL, *m;
+    struct stub_manager *result = NULL;
+    struct wine_rb_entry *entry;
 
     EnterCriticalSection(&apt->cs);
-    LIST_FOR_EACH_ENTRY(m, &apt->stubmgrs, struct stub_manager, entry)
+    if ((entry = wine_rb_get(&apt->stubmgrs_by_oid, &oid)))
     {
-        if (m->oid == oid)
-        {
-            result = m;
-            stub_manager_int_addref(result);
-            break;
-        }
+        result = WINE_RB_ENTRY_VALUE(entry, struct stub_manager, oid_entry);
+        stub_manager_int_addref(result);
     }
     LeaveCriticalSection(&apt->cs);
 
@@ -471,17 +504,13 @@ ULONG stub_manager_ext_release(struct stub_manager *m, ULONG refs, BOOL tablewea
  * it must also call release on the stub manager when it is no longer needed */
 static struct stub_manager *get_stub_manager_from_ipid(struct apartment *apt, const IPID *ipid, struct ifstub **ifstub)
 {
-    struct stub_manager *result = NULL, *m;
+    struct stub_manager *result = NULL;
 
     EnterCriticalSection(&apt->cs);
-    LIST_FOR_EACH_ENTRY(m, &apt->stubmgrs, struct stub_manager, entry)
+    if ((*ifstub = apartment_ipid_to_ifstub(apt, ipid)))
     {
-        if ((*ifstub = stub_manager_ipid_to_ifstub(m, ipid)))
-        {
-            result = m;
-            stub_manager_int_addref(result);
-            break;
-        }
+        result = (*ifstub)->manager;
+        stub_manager_int_addref(result);
     }
     LeaveCriticalSection(&apt->cs);
 
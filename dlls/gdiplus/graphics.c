@@ -422,6 +422,27 @@ static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_
 
     GdipGetCompositingMode(graphics, &comp_mode);
 
+    if (comp_mode != CompositingModeSourceCopy && !(fmt & PixelFormatPAlpha) &&
+        dst_bitmap->format == PixelFormat32bppARGB && dst_bitmap->bits &&
+        dst_x >= 0 && dst_y >= 0 && dst_x + src_width <= dst_bitmap->width &&
+        dst_y + src_height <= dst_bitmap->height)
+    {
+        /* Blend straight into the bits, this is what Get/SetPixel would do. */
+        for (y=0; y<src_height; y++)
+        {
+            const ARGB *src_row = (const ARGB*)(src + src_stride * y);
+            ARGB *dst_row = (ARGB*)(dst_bitmap->bits + dst_bitmap->stride * (y+dst_y)) + dst_x;
+
+            for (x=0; x<src_width; x++)
+            {
+                if (src_row[x] & 0xff000000)
+                    dst_row[x] = color_over(dst_row[x], src_row[x]);
+            }
+        }
+
+        return Ok;
+    }
+
     for (y=0; y<src_height; y++)
     {
         for (x=0; x<src_width; x++)
@@ -897,25 +918,46 @@ PixelFormat apply_image_attributes(const GpImageAttributes *attributes, LPBYTE d
     return fmt;
 }
 
+static BOOL use_prefilter(InterpolationMode interpolation, REAL scale)
+{
+    return (interpolation == InterpolationModeHighQualityBilinear ||
+            interpolation == InterpolationModeHighQualityBicubic) && scale >= 2.0;
+}
+
+/* Number of extra source pixels needed around a sample point. */
+static INT get_filter_margin(InterpolationMode interpolation, REAL scale)
+{
+    INT margin = 0;
+
+    if (interpolation == InterpolationModeBicubic ||
+        interpolation == InterpolationModeHighQualityBicubic)
+        margin = 2;
+    if (use_prefilter(interpolation, scale))
+        margin = max(margin, (INT)ceilf(scale / 2.0) + 1);
+    return margin;
+}
+
 /* Given a bitmap and its source rectangle, find the smallest rectangle in the
- * bitmap that contains all the pixels we may need to draw it. */
+ * bitmap that contains all the pixels we may need to draw it. scale_x and
+ * scale_y give the number of source pixels covered by a destination pixel. */
 static void get_bitmap_sample_size(InterpolationMode interpolation, WrapMode wrap,
     GpBitmap* bitmap, REAL srcx, REAL srcy, REAL srcwidth, REAL srcheight,
-    GpRect *rect)
+    REAL scale_x, REAL scale_y, GpRect *rect)
 {
-    INT left, top, right, bottom;
+    INT left, top, right, bottom, margin_x, margin_y;
 
     switch (interpolation)
     {
     case InterpolationModeHighQualityBilinear:
     case InterpolationModeHighQualityBicubic:
-    /* FIXME: Include a greater range for the prefilter? */
     case InterpolationModeBicubic:
     case InterpolationModeBilinear:
-        left = (INT)(floorf(srcx));
-        top = (INT)(floorf(srcy));
-        right = (INT)(ceilf(srcx+srcwidth));
-        bottom = (INT)(ceilf(srcy+srcheight));
+        margin_x = get_filter_margin(interpolation, scale_x);
+        margin_y = get_filter_margin(interpolation, scale_y);
+        left = (INT)(floorf(srcx)) - margin_x;
+        top = (INT)(floorf(srcy)) - margin_y;
+        right = (INT)(ceilf(srcx+srcwidth)) + margin_x;
+        bottom = (INT)(ceilf(srcy+srcheight)) + margin_y;
         break;
     case InterpolationModeNearestNeighbor:
     default:
@@ -1011,6 +1053,89 @@ static ARGB sample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT wi
     return ((DWORD*)(bits))[(x - src_rect->X) + (y - src_rect->Y) * src_rect->Width];
 }
 
+/* Keys cubic convolution kernel with a = -0.5. */
+static void get_cubic_weights(REAL t, REAL *weights)
+{
+    REAL t2 = t * t, t3 = t2 * t;
+
+    weights[0] = -0.5f * t3 + t2 - 0.5f * t;
+    weights[1] = 1.5f * t3 - 2.5f * t2 + 1.0f;
+    weights[2] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+    weights[3] = 0.5f * t3 - 0.5f * t2;
+}
+
+static ARGB unpremultiply_sum(REAL a, REAL r, REAL g, REAL b)
+{
+    INT ia, ir, ig, ib;
+
+    if (a < 0.5f) return 0;
+
+    ia = min(gdip_round(a), 0xff);
+    ir = min(max(gdip_round(r / a), 0), 0xff);
+    ig = min(max(gdip_round(g / a), 0), 0xff);
+    ib = min(max(gdip_round(b / a), 0), 0xff);
+    return ia << 24 | ir << 16 | ig << 8 | ib;
+}
+
+static ARGB resample_bitmap_pixel_bicubic(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
+    UINT height, GpPointF *point, GDIPCONST GpImageAttributes *attributes)
+{
+    REAL leftxf = floorf(point->X), topyf = floorf(point->Y);
+    INT leftx = (INT)leftxf, topy = (INT)topyf, i, j;
+    REAL wx[4], wy[4], a = 0.0, r = 0.0, g = 0.0, b = 0.0;
+
+    get_cubic_weights(point->X - leftxf, wx);
+    get_cubic_weights(point->Y - topyf, wy);
+
+    for (j = 0; j < 4; j++)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            ARGB color = sample_bitmap_pixel(src_rect, bits, width, height,
+                leftx - 1 + i, topy - 1 + j, attributes);
+            REAL weight = wx[i] * wy[j] * (color >> 24);
+
+            a += weight;
+            r += weight * ((color >> 16) & 0xff);
+            g += weight * ((color >> 8) & 0xff);
+            b += weight * (color & 0xff);
+        }
+    }
+
+    return unpremultiply_sum(a, r, g, b);
+}
+
+/* Averages the source pixels whose centers fall in a scale_x by scale_y box
+ * around the point, used to prefilter high quality downscaling. */
+static ARGB resample_bitmap_pixel_box(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
+    UINT height, GpPointF *point, REAL scale_x, REAL scale_y, GDIPCONST GpImageAttributes *attributes)
+{
+    INT left = (INT)ceilf(point->X - scale_x / 2.0), right = (INT)ceilf(point->X + scale_x / 2.0);
+    INT top = (INT)ceilf(point->Y - scale_y / 2.0), bottom = (INT)ceilf(point->Y + scale_y / 2.0);
+    REAL a = 0.0, r = 0.0, g = 0.0, b = 0.0;
+    INT x, y, count;
+
+    if (right <= left) right = left + 1;
+    if (bottom <= top) bottom = top + 1;
+    count = (right - left) * (bottom - top);
+
+    for (y = top; y < bottom; y++)
+    {
+        for (x = left; x < right; x++)
+        {
+            ARGB color = sample_bitmap_pixel(src_rect, bits, width, height, x, y, attributes);
+            REAL alpha = color >> 24;
+
+            a += alpha;
+            r += alpha * ((color >> 16) & 0xff);
+            g += alpha * ((color >> 8) & 0xff);
+            b += alpha * (color & 0xff);
+        }
+    }
+
+    return unpremultiply_sum(a / count, r / count, g / count, b / count);
+}
+
 static ARGB resample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
     UINT height, GpPointF *point, GDIPCONST GpImageAttributes *attributes,
     InterpolationMode interpolation, PixelOffsetMode offset_mode)
@@ -1019,11 +1144,15 @@ static ARGB resample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT
 
     switch (interpolation)
     {
+    case InterpolationModeBicubic:
+    case InterpolationModeHighQualityBicubic:
+        return resample_bitmap_pixel_bicubic(src_rect, bits, width, height, point, attributes);
     default:
         if (!fixme++)
             FIXME("Unimplemented interpolation %i\n", interpolation);
         /* fall-through */
     case InterpolationModeBilinear:
+    case InterpolationModeHighQualityBilinear:
     {
         REAL leftxf, topyf;
         INT leftx, rightx, topy, bottomy;
@@ -1080,6 +1209,90 @@ static ARGB resample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT
     }
 }
 
+/* Resamples a row of destination pixels. The source point of destination
+ * pixel (x, y) is origin + x * x_step + y * y_step. Pixels whose source point
+ * falls outside bounds, if given, are set to transparent. */
+static void resample_bitmap_span(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
+    UINT height, GDIPCONST GpPointF *origin, GDIPCONST GpPointF *x_step, GDIPCONST GpPointF *y_step,
+    INT x, INT y, INT count, GDIPCONST GpRectF *bounds, GDIPCONST GpImageAttributes *attributes,
+    InterpolationMode interpolation, PixelOffsetMode offset_mode, ARGB *dst)
+{
+    const ARGB *src = (const ARGB *)bits;
+    INT right = src_rect->X + src_rect->Width - 1, bottom = src_rect->Y + src_rect->Height - 1;
+    REAL scale_x = fabsf(x_step->X) + fabsf(y_step->X);
+    REAL scale_y = fabsf(x_step->Y) + fabsf(y_step->Y);
+    BOOL prefilter = use_prefilter(interpolation, scale_x) || use_prefilter(interpolation, scale_y);
+    FLOAT pixel_offset = 0.5;
+    INT i;
+
+    if (offset_mode == PixelOffsetModeHalf || offset_mode == PixelOffsetModeHighQuality)
+        pixel_offset = 0.0;
+
+    for (i = 0; i < count; i++, x++)
+    {
+        GpPointF point;
+
+        point.X = origin->X + x * x_step->X + y * y_step->X;
+        point.Y = origin->Y + x * x_step->Y + y * y_step->Y;
+
+        if (bounds && !(point.X >= bounds->X && point.X < bounds->X + bounds->Width &&
+                        point.Y >= bounds->Y && point.Y < bounds->Y + bounds->Height))
+        {
+            dst[i] = 0;
+            continue;
+        }
+
+        if (prefilter)
+        {
+            dst[i] = resample_bitmap_pixel_box(src_rect, bits, width, height, &point,
+                max(scale_x, 1.0), max(scale_y, 1.0), attributes);
+            continue;
+        }
+
+        /* Fast paths for samples that lie entirely inside the source buffer,
+         * they don't need any wrapping. */
+        if (interpolation == InterpolationModeBilinear ||
+            interpolation == InterpolationModeHighQualityBilinear)
+        {
+            REAL leftxf = floorf(point.X), topyf = floorf(point.Y);
+            INT leftx = (INT)leftxf, topy = (INT)topyf;
+            INT rightx = (INT)ceilf(point.X), bottomy = (INT)ceilf(point.Y);
+
+            if (leftx >= src_rect->X && topy >= src_rect->Y && rightx <= right && bottomy <= bottom)
+            {
+                const ARGB *top_row = src + (topy - src_rect->Y) * src_rect->Width - src_rect->X;
+                const ARGB *bottom_row = src + (bottomy - src_rect->Y) * src_rect->Width - src_rect->X;
+                REAL x_offset;
+
+                if (leftx == rightx && topy == bottomy)
+                {
+                    dst[i] = top_row[leftx];
+                    continue;
+                }
+
+                x_offset = point.X - leftxf;
+                dst[i] = blend_colors(blend_colors(top_row[leftx], top_row[rightx], x_offset),
+                                      blend_colors(bottom_row[leftx], bottom_row[rightx], x_offset),
+                                      point.Y - topyf);
+                continue;
+            }
+        }
+        else if (interpolation == InterpolationModeNearestNeighbor)
+        {
+            INT px = (INT)floorf(point.X + pixel_offset), py = (INT)floorf(point.Y + pixel_offset);
+
+            if (px >= src_rect->X && py >= src_rect->Y && px <= right && py <= bottom)
+            {
+                dst[i] = src[(py - src_rect->Y) * src_rect->Width + px - src_rect->X];
+                continue;
+            }
+        }
+
+        dst[i] = resample_bitmap_pixel(src_rect, bits, width, height, &point,
+            attributes, interpolation, offset_mode);
+    }
+}
+
 static REAL intersect_line_scanline(const GpPointF *p1, const GpPointF *p2, REAL y)
 {
     return (p1->X - p2->X) * (p2->Y - y) / (p2->Y - p1->Y) + p2->X;
@@ -1294,7 +1507,7 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         GpTexture *fill = (GpTexture*)brush;
         GpPointF draw_points[3];
         GpStatus stat;
-        int x, y;
+        int y;
         GpBitmap *bitmap;
         int src_stride;
         GpRect src_area;
@@ -1374,19 +1587,14 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
             REAL y_dx = draw_points[2].X - draw_points[0].X;
             REAL y_dy = draw_points[2].Y - draw_points[0].Y;
 
+            GpPointF x_step = {x_dx, x_dy}, y_step = {y_dx, y_dy};
+
             for (y=0; y<fill_area->Height; y++)
             {
-                for (x=0; x<fill_area->Width; x++)
-                {
-                    GpPointF point;
-                    point.X = draw_points[0].X + x * x_dx + y * y_dx;
-                    point.Y = draw_points[0].Y + x * x_dy + y * y_dy;
-
-                    argb_pixels[x + y*cdwStride] = resample_bitmap_pixel(
-                        &src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
-                        &point, fill->imageattributes, graphics->interpolation,
-                        graphics->pixeloffset);
-                }
+                resample_bitmap_span(&src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
+                    &draw_points[0], &x_step, &y_step, 0, y, fill_area->Width, NULL,
+                    fill->imageattributes, graphics->interpolation, graphics->pixeloffset,
+                    argb_pixels + y*cdwStride);
             }
         }
 
@@ -3153,7 +3361,7 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             RECT dst_area;
             GpRectF graphics_bounds;
             GpRect src_area;
-            int i, x, y, src_stride, dst_stride;
+            int i, y, src_stride, dst_stride;
             GpMatrix dst_to_src;
             REAL m11, m12, m21, m22, mdx, mdy;
             LPBYTE src_data, dst_data, dst_dyn_data=NULL;
@@ -3161,7 +3369,8 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             InterpolationMode interpolation = graphics->interpolation;
             PixelOffsetMode offset_mode = graphics->pixeloffset;
             GpPointF dst_to_src_points[3] = {{0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0}};
-            REAL x_dx, x_dy, y_dx, y_dy;
+            GpPointF x_step, y_step;
+            GpRectF src_bounds;
             static const GpImageAttributes defaultImageAttributes = {WrapModeClamp, 0, FALSE};
 
             if (!imageAttributes)
@@ -3204,7 +3413,9 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             if (do_resampling)
             {
                 get_bitmap_sample_size(interpolation, imageAttributes->wrap,
-                    bitmap, srcx, srcy, srcwidth, srcheight, &src_area);
+                    bitmap, srcx, srcy, srcwidth, srcheight,
+                    fabsf(dst_to_src.matrix[0]) + fabsf(dst_to_src.matrix[2]),
+                    fabsf(dst_to_src.matrix[1]) + fabsf(dst_to_src.matrix[3]), &src_area);
             }
             else
             {
@@ -3262,29 +3473,22 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
 
                 GdipTransformMatrixPoints(&dst_to_src, dst_to_src_points, 3);
 
-                x_dx = dst_to_src_points[1].X - dst_to_src_points[0].X;
-                x_dy = dst_to_src_points[1].Y - dst_to_src_points[0].Y;
-                y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
-                y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
-
-                for (x=dst_area.left; x<dst_area.right; x++)
-                {
-                    for (y=dst_area.top; y<dst_area.bottom; y++)
-                    {
-                        GpPointF src_pointf;
-                        ARGB *dst_color;
-
-                        src_pointf.X = dst_to_src_points[0].X + x * x_dx + y * y_dx;
-                        src_pointf.Y = dst_to_src_points[0].Y + x * x_dy + y * y_dy;
+                x_step.X = dst_to_src_points[1].X - dst_to_src_points[0].X;
+                x_step.Y = dst_to_src_points[1].Y - dst_to_src_points[0].Y;
+                y_step.X = dst_to_src_points[2].X - dst_to_src_points[0].X;
+                y_step.Y = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
 
-                        dst_color = (ARGB*)(dst_data + dst_stride * (y - dst_area.top) + sizeof(ARGB) * (x - dst_area.left));
+                src_bounds.X = srcx;
+                src_bounds.Y = srcy;
+                src_bounds.Width = srcwidth;
+                src_bounds.Height = srcheight;
 
-                        if (src_pointf.X >= srcx && src_pointf.X < srcx + srcwidth && src_pointf.Y >= srcy && src_pointf.Y < srcy+srcheight)
-                            *dst_color = resample_bitmap_pixel(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                               imageAttributes, interpolation, offset_mode);
-                        else
-                            *dst_color = 0;
-                    }
+                for (y=dst_area.top; y<dst_area.bottom; y++)
+                {
+                    resample_bitmap_span(&src_area, src_data, bitmap->width, bitmap->height,
+                        &dst_to_src_points[0], &x_step, &y_step, dst_area.left, y,
+                        dst_area.right - dst_area.left, &src_bounds, imageAttributes,
+                        interpolation, offset_mode, (ARGB *)(dst_data + dst_stride * (y - dst_area.top)));
                 }
             }
             else
@@ -4320,6 +4524,312 @@ end:
     return retval;
 }
 
+/* Number of sub-scanlines sampled per pixel row by the antialiasing
+ * rasterizer; horizontal coverage is computed exactly. */
+#define RASTER_SUBSCANLINES 4
+
+typedef struct raster_edge
+{
+    REAL y_top, y_bottom;
+    REAL x_top, dxdy;
+    INT winding;
+} raster_edge;
+
+typedef struct raster_crossing
+{
+    REAL x;
+    INT winding;
+} raster_crossing;
+
+static BOOL is_antialiased(GpGraphics *graphics)
+{
+    return graphics->smoothing != SmoothingModeDefault &&
+           graphics->smoothing != SmoothingModeNone &&
+           graphics->smoothing != SmoothingModeHighSpeed;
+}
+
+static int __cdecl compare_raster_edges(const void *a, const void *b)
+{
+    const raster_edge *edge1 = a, *edge2 = b;
+
+    if (edge1->y_top < edge2->y_top) return -1;
+    if (edge1->y_top > edge2->y_top) return 1;
+    return 0;
+}
+
+static void add_raster_edge(raster_edge *edges, INT *count, const GpPointF *p1, const GpPointF *p2)
+{
+    raster_edge *edge = &edges[*count];
+
+    if (p1->Y == p2->Y)
+        return;
+
+    if (p1->Y < p2->Y)
+    {
+        edge->y_top = p1->Y;
+        edge->y_bottom = p2->Y;
+        edge->x_top = p1->X;
+        edge->winding = 1;
+    }
+    else
+    {
+        edge->y_top = p2->Y;
+        edge->y_bottom = p1->Y;
+        edge->x_top = p2->X;
+        edge->winding = -1;
+    }
+    edge->dxdy = (p2->X - p1->X) / (p2->Y - p1->Y);
+    (*count)++;
+}
+
+/* Adds the coverage of the span [x0, x1) to the delta array cover, whose
+ * running sum is the coverage of each pixel. */
+static void add_coverage_span(REAL *cover, REAL x0, REAL x1, REAL weight)
+{
+    INT i0 = floorf(x0), i1 = floorf(x1);
+
+    if (i0 == i1)
+    {
+        cover[i0] += (x1 - x0) * weight;
+        cover[i0 + 1] -= (x1 - x0) * weight;
+        return;
+    }
+
+    cover[i0] += (i0 + 1 - x0) * weight;
+    cover[i0 + 1] += (x0 - i0) * weight;
+    cover[i1] += (x1 - i1 - 1) * weight;
+    cover[i1 + 1] -= (x1 - i1) * weight;
+}
+
+/* Renders a path with an antialiasing scanline rasterizer. Pixel coverage is
+ * accumulated per row from the crossings of the flattened edges with a few
+ * sub-scanlines, and the brush is only evaluated over the covered part of
+ * each row. */
+static GpStatus SOFTWARE_GdipFillPathAntialias(GpGraphics *graphics, GpBrush *brush, GpPath *path)
+{
+    GpStatus stat;
+    GpPath *flat_path;
+    GpMatrix world_to_device;
+    GpRectF device_bounds;
+    GpRect fill_area, row_area;
+    raster_edge *edges = NULL;
+    raster_crossing *crossings = NULL;
+    INT *active = NULL;
+    REAL *cover = NULL;
+    DWORD *pixel_data = NULL;
+    REAL offset, min_x, min_y, max_x, max_y;
+    INT edge_count = 0, active_count = 0, next_edge = 0;
+    INT i, x, y, s, figure_start = 0;
+    CompositingMode comp_mode;
+
+    GdipGetCompositingMode(graphics, &comp_mode);
+    if (comp_mode == CompositingModeSourceCopy)
+        return NotImplemented;
+
+    stat = GdipClonePath(path, &flat_path);
+    if (stat != Ok)
+        return stat;
+
+    stat = get_graphics_transform(graphics, WineCoordinateSpaceGdiDevice,
+        CoordinateSpaceWorld, &world_to_device);
+
+    if (stat == Ok)
+        stat = GdipFlattenPath(flat_path, &world_to_device, 0.25);
+
+    if (stat == Ok)
+        stat = get_graphics_device_bounds(graphics, &device_bounds);
+
+    if (stat != Ok || !flat_path->pathdata.Count)
+    {
+        GdipDeletePath(flat_path);
+        return stat;
+    }
+
+    /* Pixel centers are at integer coordinates unless the pixel offset mode
+     * says otherwise; shift the geometry so that pixel x covers [x, x+1). */
+    if (graphics->pixeloffset == PixelOffsetModeHalf || graphics->pixeloffset == PixelOffsetModeHighQuality)
+        offset = 0.0;
+    else
+        offset = 0.5;
+
+    min_x = max_x = flat_path->pathdata.Points[0].X + offset;
+    min_y = max_y = flat_path->pathdata.Points[0].Y + offset;
+    for (i = 0; i < flat_path->pathdata.Count; i++)
+    {
+        GpPointF *pt = &flat_path->pathdata.Points[i];
+
+        pt->X += offset;
+        pt->Y += offset;
+        if (pt->X < min_x) min_x = pt->X;
+        if (pt->X > max_x) max_x = pt->X;
+        if (pt->Y < min_y) min_y = pt->Y;
+        if (pt->Y > max_y) max_y = pt->Y;
+    }
+
+    fill_area.X = max(floorf(min_x), device_bounds.X);
+    fill_area.Y = max(floorf(min_y), device_bounds.Y);
+    fill_area.Width = min(ceilf(max_x), device_bounds.X + device_bounds.Width) - fill_area.X;
+    fill_area.Height = min(ceilf(max_y), device_bounds.Y + device_bounds.Height) - fill_area.Y;
+
+    if (fill_area.Width <= 0 || fill_area.Height <= 0)
+    {
+        GdipDeletePath(flat_path);
+        return Ok;
+    }
+
+    edges = heap_alloc(sizeof(*edges) * flat_path->pathdata.Count);
+    crossings = heap_alloc(sizeof(*crossings) * flat_path->pathdata.Count);
+    active = heap_alloc(sizeof(*active) * flat_path->pathdata.Count);
+    cover = heap_alloc(sizeof(*cover) * (fill_area.Width + 2));
+    pixel_data = heap_alloc_zero(sizeof(*pixel_data) * fill_area.Width * fill_area.Height);
+    if (!edges || !crossings || !active || !cover || !pixel_data)
+    {
+        stat = OutOfMemory;
+        goto end;
+    }
+
+    /* Collect the edges of all figures, closing each of them. */
+    for (i = 0; i < flat_path->pathdata.Count; i++)
+    {
+        BYTE type = flat_path->pathdata.Types[i];
+
+        if ((type & PathPointTypePathTypeMask) == PathPointTypeStart)
+            figure_start = i;
+
+        if ((type & PathPointTypeCloseSubpath) || i + 1 == flat_path->pathdata.Count ||
+            (flat_path->pathdata.Types[i + 1] & PathPointTypePathTypeMask) == PathPointTypeStart)
+            add_raster_edge(edges, &edge_count, &flat_path->pathdata.Points[i],
+                &flat_path->pathdata.Points[figure_start]);
+        else
+            add_raster_edge(edges, &edge_count, &flat_path->pathdata.Points[i],
+                &flat_path->pathdata.Points[i + 1]);
+    }
+
+    qsort(edges, edge_count, sizeof(*edges), compare_raster_edges);
+
+    /* Path gradients flatten their own path for every call, so evaluate
+     * those once for the whole area instead of per span. */
+    if (brush->bt == BrushTypePathGradient)
+    {
+        stat = brush_fill_pixels(graphics, brush, pixel_data, &fill_area, fill_area.Width);
+        if (stat != Ok)
+            goto end;
+    }
+
+    for (y = 0; y < fill_area.Height; y++)
+    {
+        DWORD *row = pixel_data + y * fill_area.Width;
+        INT row_min = fill_area.Width, row_max = 0;
+        REAL coverage;
+
+        memset(cover, 0, sizeof(*cover) * (fill_area.Width + 2));
+
+        for (s = 0; s < RASTER_SUBSCANLINES; s++)
+        {
+            REAL yf = fill_area.Y + y + (s + 0.5) / RASTER_SUBSCANLINES;
+            INT crossing_count = 0, winding = 0;
+
+            while (next_edge < edge_count && edges[next_edge].y_top <= yf)
+                active[active_count++] = next_edge++;
+
+            for (i = 0; i < active_count; i++)
+            {
+                raster_edge *edge = &edges[active[i]];
+                raster_crossing crossing;
+                INT j;
+
+                if (edge->y_bottom <= yf)
+                {
+                    active[i--] = active[--active_count];
+                    continue;
+                }
+
+                crossing.x = edge->x_top + (yf - edge->y_top) * edge->dxdy - fill_area.X;
+                crossing.winding = edge->winding;
+
+                for (j = crossing_count; j > 0 && crossings[j - 1].x > crossing.x; j--)
+                    crossings[j] = crossings[j - 1];
+                crossings[j] = crossing;
+                crossing_count++;
+            }
+
+            for (i = 0; i + 1 < crossing_count; i++)
+            {
+                REAL x0, x1;
+
+                winding += crossings[i].winding;
+                if (path->fill == FillModeAlternate ? !(winding & 1) : !winding)
+                    continue;
+
+                x0 = max(crossings[i].x, 0.0f);
+                x1 = min(crossings[i + 1].x, (REAL)fill_area.Width);
+                if (x0 >= x1)
+                    continue;
+
+                add_coverage_span(cover, x0, x1, 1.0 / RASTER_SUBSCANLINES);
+                row_min = min(row_min, (INT)floorf(x0));
+                row_max = max(row_max, (INT)ceilf(x1));
+            }
+        }
+
+        if (row_min >= row_max)
+        {
+            if (brush->bt == BrushTypePathGradient)
+                memset(row, 0, sizeof(*row) * fill_area.Width);
+            continue;
+        }
+
+        if (brush->bt == BrushTypePathGradient)
+        {
+            memset(row, 0, sizeof(*row) * row_min);
+            memset(row + row_max, 0, sizeof(*row) * (fill_area.Width - row_max));
+        }
+        else
+        {
+            row_area.X = fill_area.X + row_min;
+            row_area.Y = fill_area.Y + y;
+            row_area.Width = row_max - row_min;
+            row_area.Height = 1;
+
+            stat = brush_fill_pixels(graphics, brush, row + row_min, &row_area, row_area.Width);
+            if (stat != Ok)
+                goto end;
+        }
+
+        /* Scale the brush alpha by the pixel coverage. */
+        coverage = 0.0;
+        for (x = row_min; x < row_max; x++)
+        {
+            coverage += cover[x];
+            if (coverage >= 0.999)
+                continue;
+            if (coverage <= 0.001)
+                row[x] = 0;
+            else
+                row[x] = (row[x] & 0x00ffffff) | (DWORD)((row[x] >> 24) * coverage + 0.5) << 24;
+        }
+    }
+
+    if (stat == Ok)
+    {
+        gdi_transform_acquire(graphics);
+
+        stat = alpha_blend_pixels(graphics, fill_area.X, fill_area.Y, (BYTE *)pixel_data,
+            fill_area.Width, fill_area.Height, fill_area.Width * 4, PixelFormat32bppARGB);
+
+        gdi_transform_release(graphics);
+    }
+
+end:
+    heap_free(pixel_data);
+    heap_free(cover);
+    heap_free(active);
+    heap_free(crossings);
+    heap_free(edges);
+    GdipDeletePath(flat_path);
+    return stat;
+}
+
 static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
     GpStatus stat;
@@ -4328,6 +4838,13 @@ static GpStatus SOFTWARE_GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPa
     if (!brush_can_fill_pixels(brush))
         return NotImplemented;
 
+    if (is_antialiased(graphics))
+    {
+        stat = SOFTWARE_GdipFillPathAntialias(graphics, brush, path);
+        if (stat != NotImplemented)
+            return stat;
+    }
+
     /* FIXME: This could probably be done more efficiently without regions. */
 
     stat = GdipCreateRegionPath(path, &rgn);
@@ -4360,7 +4877,8 @@ GpStatus WINGDIPAPI GdipFillPath(GpGraphics *graphics, GpBrush *brush, GpPath *p
     if (is_metafile_graphics(graphics))
         return METAFILE_FillPath((GpMetafile*)graphics->image, brush, path);
 
-    if (!graphics->image && !graphics->alpha_hdc)
+    /* gdi32 can't antialias, so only use it for aliased fills. */
+    if (!graphics->image && !graphics->alpha_hdc && !is_antialiased(graphics))
         stat = GDI32_GdipFillPath(graphics, brush, path);
 
     if (stat == NotImplemented)
@@ -6937,6 +6937,233 @@ static void test_gdi_interop_bitmap(void)
     expect(Ok, stat);
 }
 
+static void test_antialias_fill(void)
+{
+    GpBitmap *bitmap;
+    GpGraphics *graphics;
+    GpSolidFill *brush;
+    GpStatus stat;
+    ARGB color;
+
+    stat = GdipCreateBitmapFromScan0(16, 16, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, stat);
+
+    stat = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, stat);
+
+    stat = GdipSetSmoothingMode(graphics, SmoothingModeAntiAlias);
+    expect(Ok, stat);
+
+    stat = GdipSetPixelOffsetMode(graphics, PixelOffsetModeHalf);
+    expect(Ok, stat);
+
+    stat = GdipCreateSolidFill((ARGB)0xff0000ff, &brush);
+    expect(Ok, stat);
+
+    /* The left edge ends up in the middle of pixel column 2. */
+    stat = GdipFillRectangle(graphics, (GpBrush*)brush, 2.5, 2.0, 8.5, 4.0);
+    expect(Ok, stat);
+
+    stat = GdipBitmapGetPixel(bitmap, 5, 3, &color);
+    expect(Ok, stat);
+    expect(0xff0000ff, color);
+
+    stat = GdipBitmapGetPixel(bitmap, 2, 3, &color);
+    expect(Ok, stat);
+    ok((color & 0xffffff) == 0xff && (color >> 24) >= 0x70 && (color >> 24) <= 0x90,
+        "got %08x\n", color);
+
+    stat = GdipBitmapGetPixel(bitmap, 1, 3, &color);
+    expect(Ok, stat);
+    expect(0, color);
+
+    stat = GdipBitmapGetPixel(bitmap, 5, 6, &color);
+    expect(Ok, stat);
+    expect(0, color);
+
+    /* Without a pixel offset the pixel centers are on the rectangle edges. */
+    stat = GdipSetPixelOffsetMode(graphics, PixelOffsetModeNone);
+    expect(Ok, stat);
+
+    stat = GdipFillRectangle(graphics, (GpBrush*)brush, 2.0, 10.0, 4.0, 4.0);
+    expect(Ok, stat);
+
+    stat = GdipBitmapGetPixel(bitmap, 3, 11, &color);
+    expect(Ok, stat);
+    expect(0xff0000ff, color);
+
+    stat = GdipBitmapGetPixel(bitmap, 3, 14, &color);
+    expect(Ok, stat);
+    ok((color & 0xffffff) == 0xff && (color >> 24) >= 0x70 && (color >> 24) <= 0x90,
+        "got %08x\n", color);
+
+    GdipDeleteBrush((GpBrush*)brush);
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage*)bitmap);
+}
+
+static BOOL color_match(ARGB c1, ARGB c2, BYTE max_diff)
+{
+    if (abs((c1 & 0xff) - (c2 & 0xff)) > max_diff) return FALSE;
+    c1 >>= 8; c2 >>= 8;
+    if (abs((c1 & 0xff) - (c2 & 0xff)) > max_diff) return FALSE;
+    c1 >>= 8; c2 >>= 8;
+    if (abs((c1 & 0xff) - (c2 & 0xff)) > max_diff) return FALSE;
+    c1 >>= 8; c2 >>= 8;
+    if (abs((c1 & 0xff) - (c2 & 0xff)) > max_diff) return FALSE;
+    return TRUE;
+}
+
+static void test_drawimage_interpolation(void)
+{
+    static const InterpolationMode modes[] =
+    {
+        InterpolationModeBicubic,
+        InterpolationModeHighQualityBilinear,
+        InterpolationModeHighQualityBicubic,
+    };
+    GpBitmap *solid, *checker, *bitmap;
+    GpGraphics *graphics;
+    GpStatus stat;
+    ARGB color;
+    UINT i, x, y;
+
+    stat = GdipCreateBitmapFromScan0(16, 16, 0, PixelFormat32bppARGB, NULL, &solid);
+    expect(Ok, stat);
+    stat = GdipCreateBitmapFromScan0(16, 16, 0, PixelFormat32bppARGB, NULL, &checker);
+    expect(Ok, stat);
+    for (y = 0; y < 16; y++)
+    {
+        for (x = 0; x < 16; x++)
+        {
+            GdipBitmapSetPixel(solid, x, y, 0xff336699);
+            GdipBitmapSetPixel(checker, x, y, (x + y) % 2 ? 0xffffffff : 0xff000000);
+        }
+    }
+
+    stat = GdipCreateBitmapFromScan0(32, 32, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, stat);
+    stat = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, stat);
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        stat = GdipSetInterpolationMode(graphics, modes[i]);
+        expect(Ok, stat);
+
+        /* upscaling a solid image keeps its color */
+        stat = GdipGraphicsClear(graphics, 0);
+        expect(Ok, stat);
+        stat = GdipDrawImageRectRectI(graphics, (GpImage*)solid, 0, 0, 32, 32, 0, 0, 4, 4,
+                                      UnitPixel, NULL, NULL, NULL);
+        expect(Ok, stat);
+        stat = GdipBitmapGetPixel(bitmap, 16, 16, &color);
+        expect(Ok, stat);
+        ok(color_match(color, 0xff336699, 1), "%u: got %08x\n", modes[i], color);
+
+        /* and so does downscaling it by 4x */
+        stat = GdipGraphicsClear(graphics, 0);
+        expect(Ok, stat);
+        stat = GdipDrawImageRectRectI(graphics, (GpImage*)solid, 0, 0, 4, 4, 0, 0, 16, 16,
+                                      UnitPixel, NULL, NULL, NULL);
+        expect(Ok, stat);
+        stat = GdipBitmapGetPixel(bitmap, 2, 2, &color);
+        expect(Ok, stat);
+        ok(color_match(color, 0xff336699, 1), "%u: got %08x\n", modes[i], color);
+        stat = GdipBitmapGetPixel(bitmap, 8, 8, &color);
+        expect(Ok, stat);
+        expect(0, color);
+    }
+
+    /* the high quality modes average a checkerboard when downscaling it by 4x */
+    for (i = 1; i < ARRAY_SIZE(modes); i++)
+    {
+        stat = GdipSetInterpolationMode(graphics, modes[i]);
+        expect(Ok, stat);
+        stat = GdipGraphicsClear(graphics, 0);
+        expect(Ok, stat);
+        stat = GdipDrawImageRectRectI(graphics, (GpImage*)checker, 0, 0, 4, 4, 0, 0, 16, 16,
+                                      UnitPixel, NULL, NULL, NULL);
+        expect(Ok, stat);
+        stat = GdipBitmapGetPixel(bitmap, 1, 1, &color);
+        expect(Ok, stat);
+        ok(color_match(color, 0xff808080, 0x20), "%u: got %08x\n", modes[i], color);
+        stat = GdipBitmapGetPixel(bitmap, 2, 2, &color);
+        expect(Ok, stat);
+        ok(color_match(color, 0xff808080, 0x20), "%u: got %08x\n", modes[i], color);
+    }
+
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage*)bitmap);
+    GdipDisposeImage((GpImage*)checker);
+    GdipDisposeImage((GpImage*)solid);
+}
+
+static void test_texture_interpolation(void)
+{
+    static const InterpolationMode modes[] =
+    {
+        InterpolationModeNearestNeighbor,
+        InterpolationModeBilinear,
+        InterpolationModeBicubic,
+        InterpolationModeHighQualityBilinear,
+        InterpolationModeHighQualityBicubic,
+    };
+    GpBitmap *image, *bitmap;
+    GpGraphics *graphics;
+    GpTexture *brush;
+    GpStatus stat;
+    ARGB color, color2;
+    UINT i, x, y, mismatch;
+
+    stat = GdipCreateBitmapFromScan0(4, 4, 0, PixelFormat32bppARGB, NULL, &image);
+    expect(Ok, stat);
+    for (y = 0; y < 4; y++)
+        for (x = 0; x < 4; x++)
+            GdipBitmapSetPixel(image, x, y, 0xff000000 | (x * 0x40) << 16 | (y * 0x40) << 8 | (x ^ y) * 0x40);
+
+    stat = GdipCreateTexture((GpImage*)image, WrapModeTile, &brush);
+    expect(Ok, stat);
+    stat = GdipScaleTextureTransform(brush, 4.0, 4.0, MatrixOrderAppend);
+    expect(Ok, stat);
+
+    stat = GdipCreateBitmapFromScan0(32, 16, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, stat);
+    stat = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, stat);
+
+    /* The second tile only samples outside of the texture bits, so it is
+     * resampled pixel by pixel with wrapping, while most of the first tile
+     * goes through the direct span paths. Both must give the same pixels. */
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        stat = GdipSetInterpolationMode(graphics, modes[i]);
+        expect(Ok, stat);
+        stat = GdipGraphicsClear(graphics, 0);
+        expect(Ok, stat);
+        stat = GdipFillRectangleI(graphics, (GpBrush*)brush, 0, 0, 32, 16);
+        expect(Ok, stat);
+
+        mismatch = 0;
+        for (y = 0; y < 16; y++)
+        {
+            for (x = 0; x < 16; x++)
+            {
+                GdipBitmapGetPixel(bitmap, x, y, &color);
+                GdipBitmapGetPixel(bitmap, x + 16, y, &color2);
+                if (color != color2 && !mismatch++)
+                    ok(0, "%u: got %08x at %u,%u and %08x at %u,%u\n", modes[i], color, x, y, color2, x + 16, y);
+            }
+        }
+        ok(!mismatch, "%u: %u pixels differ\n", modes[i], mismatch);
+    }
+
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage*)bitmap);
+    GdipDeleteBrush((GpBrush*)brush);
+    GdipDisposeImage((GpImage*)image);
+}
+
 static void test_gdi_interop_hdc(void)
 {
     BITMAPINFO bmi;
@@ -7319,6 +7546,9 @@ START_TEST(graphics)
     test_cliphrgn_transform();
     test_hdc_caching();
     test_gdi_interop_bitmap();
+    test_antialias_fill();
+    test_drawimage_interpolation();
+    test_texture_interpolation();
     test_gdi_interop_hdc();
     test_printer_dc();
 
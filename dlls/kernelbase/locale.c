@@ -597,6 +597,15 @@ struct sortguid
 
 static const struct sortguid *current_locale_sort;
 
+/* collation data of the Latin-1 range, cached to avoid the table walks for common text */
+static unsigned int latin1_collation[0x100];
+static BYTE latin1_props[0x100];
+
+#define LATIN1_DECOMPOSABLE 0x01
+#define LATIN1_SYMBOL       0x02  /* C1_PUNCT or C1_SPACE */
+
+static void init_latin1_sort(void);
+
 static const GUID default_sort_guid = { 0x00000001, 0x57ee, 0x1e5c, { 0x00, 0xb4, 0xd0, 0x00, 0x0b, 0xb1, 0xe1, 0x1e }};
 
 static struct
@@ -761,6 +770,7 @@ void init_locale(void)
     NtGetNlsSectionPtr( 9, 0, NULL, &sort_ptr, &size );
     NtGetNlsSectionPtr( 12, NormalizationC, NULL, (void **)&norm_info, &size );
     init_sortkeys( sort_ptr );
+    init_latin1_sort();
 
     if (!ansi_cp || NtGetNlsSectionPtr( 11, ansi_cp, NULL, (void **)&ansi_ptr, &size ))
         NtGetNlsSectionPtr( 11, 1252, NULL, (void **)&ansi_ptr, &size );
@@ -925,6 +935,28 @@ static const WCHAR *get_decomposition( WCHAR ch, unsigned int *ret_len )
 }
 
 
+static void init_latin1_sort(void)
+{
+    unsigned int len;
+    WCHAR ch;
+
+    for (ch = 0; ch < 0x100; ch++)
+    {
+        latin1_collation[ch] = collation_table[collation_table[collation_table[0] + (ch >> 4)] + (ch & 0xf)];
+        latin1_props[ch] = 0;
+        if (get_decomposition( ch, &len )) latin1_props[ch] |= LATIN1_DECOMPOSABLE;
+        if (get_char_type( CT_CTYPE1, ch ) & (C1_PUNCT | C1_SPACE)) latin1_props[ch] |= LATIN1_SYMBOL;
+    }
+}
+
+
+static inline unsigned int get_collation( WCHAR ch )
+{
+    if (ch < 0x100) return latin1_collation[ch];
+    return collation_table[collation_table[collation_table[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0xf)];
+}
+
+
 static WCHAR compose_chars( WCHAR ch1, WCHAR ch2 )
 {
     const USHORT *table = (const USHORT *)norm_info + norm_info->comp_hash;
@@ -2191,7 +2223,7 @@ static int get_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, in
 
                 if (flags & NORM_IGNORECASE) wch = casemap( nls_info.LowerCaseTable, wch );
 
-                ce = collation_table[collation_table[collation_table[wch >> 8] + ((wch >> 4) & 0x0f)] + (wch & 0xf)];
+                ce = get_collation( wch );
                 if (ce != (unsigned int)-1)
                 {
                     if (ce >> 16) key_len[0] += 2;
@@ -2245,7 +2277,7 @@ static int get_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, in
 
                 if (flags & NORM_IGNORECASE) wch = casemap( nls_info.LowerCaseTable, wch );
 
-                ce = collation_table[collation_table[collation_table[wch >> 8] + ((wch >> 4) & 0x0f)] + (wch & 0xf)];
+                ce = get_collation( wch );
                 if (ce != (unsigned int)-1)
                 {
                     WCHAR key;
@@ -2504,7 +2536,7 @@ static unsigned int get_weight( WCHAR ch, enum weight type )
 {
     unsigned int ret;
 
-    ret = collation_table[collation_table[collation_table[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0xf)];
+    ret = get_collation( ch );
     if (ret == ~0u) return ch;
 
     switch (type)
@@ -2517,6 +2549,29 @@ static unsigned int get_weight( WCHAR ch, enum weight type )
 }
 
 
+static inline const WCHAR *get_compare_decomposition( WCHAR ch, unsigned int *len )
+{
+    if (ch < 0x100 && !(latin1_props[ch] & LATIN1_DECOMPOSABLE))
+    {
+        *len = 1;
+        return NULL;
+    }
+    return get_decomposition( ch, len );
+}
+
+
+/* check whether a Latin-1 char always compares as itself, so that it can be
+ * skipped when both strings contain it at the same position */
+static inline BOOL is_plain_latin1( int flags, WCHAR ch, enum weight type )
+{
+    if (ch >= 0x100) return FALSE;
+    if (latin1_props[ch] & LATIN1_DECOMPOSABLE) return FALSE;
+    if ((flags & NORM_IGNORESYMBOLS) && (latin1_props[ch] & LATIN1_SYMBOL)) return FALSE;
+    if (type == UNICODE_WEIGHT && !(flags & SORT_STRINGSORT) && (ch == '-' || ch == '\'')) return FALSE;
+    return get_weight( ch, type ) != 0;
+}
+
+
 static void inc_str_pos( const WCHAR **str, int *len, unsigned int *dpos, unsigned int *dlen )
 {
     (*dpos)++;
@@ -2535,10 +2590,19 @@ static int compare_weights(int flags, const WCHAR *str1, int len1,
     unsigned int ce1, ce2, dpos1 = 0, dpos2 = 0, dlen1 = 0, dlen2 = 0;
     const WCHAR *dstr1 = NULL, *dstr2 = NULL;
 
+    /* a common prefix of plain chars has equal weights and keeps both strings in step */
+    while (len1 > 0 && len2 > 0 && *str1 == *str2 && is_plain_latin1( flags, *str1, type ))
+    {
+        str1++;
+        str2++;
+        len1--;
+        len2--;
+    }
+
     while (len1 > 0 && len2 > 0)
     {
-        if (!dlen1 && !(dstr1 = get_decomposition( *str1, &dlen1 ))) dstr1 = str1;
-        if (!dlen2 && !(dstr2 = get_decomposition( *str2, &dlen2 ))) dstr2 = str2;
+        if (!dlen1 && !(dstr1 = get_compare_decomposition( *str1, &dlen1 ))) dstr1 = str1;
+        if (!dlen2 && !(dstr2 = get_compare_decomposition( *str2, &dlen2 ))) dstr2 = str2;
 
         if (flags & NORM_IGNORESYMBOLS)
         {
@@ -2597,14 +2661,14 @@ static int compare_weights(int flags, const WCHAR *str1, int len1,
     }
     while (len1)
     {
-        if (!dlen1 && !(dstr1 = get_decomposition( *str1, &dlen1 ))) dstr1 = str1;
+        if (!dlen1 && !(dstr1 = get_compare_decomposition( *str1, &dlen1 ))) dstr1 = str1;
         ce1 = get_weight( dstr1[dpos1], type );
         if (ce1) break;
         inc_str_pos( &str1, &len1, &dpos1, &dlen1 );
     }
     while (len2)
     {
-        if (!dlen2 && !(dstr2 = get_decomposition( *str2, &dlen2 ))) dstr2 = str2;
+        if (!dlen2 && !(dstr2 = get_compare_decomposition( *str2, &dlen2 ))) dstr2 = str2;
         ce2 = get_weight( dstr2[dpos2], type );
         if (ce2) break;
         inc_str_pos( &str2, &len2, &dpos2, &dlen2 );
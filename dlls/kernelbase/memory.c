@@ -1252,8 +1252,12 @@ LPVOID WINAPI DECLSPEC_HOTPATCH MapViewOfFileExNuma( HANDLE handle, DWORD access
 LPVOID WINAPI DECLSPEC_HOTPATCH VirtualAllocExNuma( HANDLE process, void *addr, SIZE_T size,
                                                     DWORD type, DWORD protect, DWORD node )
 {
-    if (node) FIXME( "Ignoring preferred node %u\n", node );
-    return VirtualAllocEx( process, addr, size, type, protect );
+    MEM_EXTENDED_PARAMETER param;
+
+    memset( &param, 0, sizeof(param) );
+    param.s.Type = MemExtendedParameterNumaNode;
+    param.u.ULong = node;
+    return VirtualAlloc2( process, addr, size, type, protect, &param, 1 );
 }
 
 
@@ -21,6 +21,7 @@
 #include <stdarg.h>
 #include "msvcp90.h"
 
+#include "winternl.h"
 #include "wine/debug.h"
 #include "wine/exception.h"
 
@@ -37,7 +38,7 @@ typedef struct _Page
 
 typedef struct
 {
-    LONG lock;
+    LONG waiters;
     _Page *head;
     _Page *tail;
     size_t head_pos;
@@ -223,22 +224,51 @@ static size_t InterlockedIncrementSizeT(size_t volatile *dest)
 #define InterlockedIncrementSizeT(dest) InterlockedIncrement((LONG*)dest)
 #endif
 
+/* Waits until *pos reaches id. Spins for a short while and then sleeps
+ * on the counter, so that threads queued behind a slow producer or
+ * consumer don't burn the cpu. */
+static void threadsafe_queue_wait(threadsafe_queue *queue, size_t volatile *pos, size_t id)
+{
+    size_t cur;
+    int spin = 0;
+
+    while((SSIZE_T)(*pos - id) < 0)
+    {
+        if(spin < 1000)
+        {
+            spin++;
+            YieldProcessor();
+            continue;
+        }
+
+        InterlockedIncrement(&queue->waiters);
+        cur = *pos;
+        if((SSIZE_T)(cur - id) < 0)
+            RtlWaitOnAddress((void*)pos, &cur, sizeof(cur), NULL);
+        InterlockedDecrement(&queue->waiters);
+    }
+}
+
+static void threadsafe_queue_advance(threadsafe_queue *queue, size_t volatile *pos)
+{
+    InterlockedIncrementSizeT(pos);
+    if(queue->waiters)
+        RtlWakeAddressAll((void*)pos);
+}
+
 static void CALLBACK queue_push_finally(BOOL normal, void *ctx)
 {
     threadsafe_queue *queue = ctx;
-    InterlockedIncrementSizeT(&queue->tail_pos);
+    threadsafe_queue_advance(queue, &queue->tail_pos);
 }
 
 static void threadsafe_queue_push(threadsafe_queue *queue, size_t id,
         void *e, _Concurrent_queue_base_v4 *parent, BOOL copy)
 {
     size_t page_id = id & ~(parent->alloc_count-1);
-    int spin;
-    _Page *p;
+    _Page *p, *prev;
 
-    spin = 0;
-    while(queue->tail_pos != id)
-        spin_wait(&spin);
+    threadsafe_queue_wait(queue, &queue->tail_pos, id);
 
     if(page_id == id)
     {
@@ -247,15 +277,13 @@ static void threadsafe_queue_push(threadsafe_queue *queue, size_t id,
         p->_Next = NULL;
         p->_Mask = 0;
 
-        spin = 0;
-        while(InterlockedCompareExchange(&queue->lock, 1, 0))
-            spin_wait(&spin);
-        if(queue->tail)
-            queue->tail->_Next = p;
-        queue->tail = p;
-        if(!queue->head)
+        /* Pushes to a sub-queue are serialized, only the consumer releasing
+         * the last page can race with us. */
+        prev = InterlockedExchangePointer((void**)&queue->tail, p);
+        if(prev)
+            *(_Page * volatile *)&prev->_Next = p;
+        else
             queue->head = p;
-        queue->lock = 0;
     }
     else
     {
@@ -277,17 +305,12 @@ static BOOL threadsafe_queue_pop(threadsafe_queue *queue, size_t id,
         void *e, _Concurrent_queue_base_v4 *parent)
 {
     size_t page_id = id & ~(parent->alloc_count-1);
-    int spin;
-    _Page *p;
+    _Page *p, *next;
     BOOL ret = FALSE;
+    int spin;
 
-    spin = 0;
-    while(queue->tail_pos <= id)
-        spin_wait(&spin);
-
-    spin = 0;
-    while(queue->head_pos != id)
-        spin_wait(&spin);
+    threadsafe_queue_wait(queue, &queue->tail_pos, id+1);
+    threadsafe_queue_wait(queue, &queue->head_pos, id);
 
     p = queue->head;
     if(p->_Mask & (1 << (id-page_id)))
@@ -299,19 +322,22 @@ static BOOL threadsafe_queue_pop(threadsafe_queue *queue, size_t id,
 
     if(id == page_id+parent->alloc_count-1)
     {
-        spin = 0;
-        while(InterlockedCompareExchange(&queue->lock, 1, 0))
-            spin_wait(&spin);
-        queue->head = p->_Next;
-        if(!queue->head)
-            queue->tail = NULL;
-        queue->lock = 0;
+        /* Clear head first, a producer that finds an empty tail sets it again. */
+        queue->head = NULL;
+        if(InterlockedCompareExchangePointer((void**)&queue->tail, NULL, p) != p)
+        {
+            /* a producer has already replaced the tail, wait for it to link the page */
+            spin = 0;
+            while(!(next = *(_Page * volatile *)&p->_Next))
+                spin_wait(&spin);
+            queue->head = next;
+        }
 
         /* TODO: Add exception handling */
         call__Concurrent_queue_base_v4__Deallocate_page(parent, p);
     }
 
-    InterlockedIncrementSizeT(&queue->head_pos);
+    threadsafe_queue_advance(queue, &queue->head_pos);
     return ret;
 }
 
@@ -170,8 +170,8 @@ struct SchedulerVtbl {
     unsigned int (__thiscall *Release)(Scheduler*);
     void (__thiscall *RegisterShutdownEvent)(Scheduler*,HANDLE);
     void (__thiscall *Attach)(Scheduler*);
-    /* CreateScheduleGroup */
-    /* ScheduleTask */
+    void* (__thiscall *CreateScheduleGroup)(Scheduler*);
+    void (__thiscall *ScheduleTask)(Scheduler*,void (__cdecl*)(void*),void*);
 };
 
 static int* (__cdecl *p_errno)(void);
@@ -956,8 +956,35 @@ static void test_ExternalContextBase(void)
     CloseHandle(thread);
 }
 
+struct schedule_task_data
+{
+    Scheduler *scheduler;
+    LONG count;
+    HANDLE event;
+};
+
+static void __cdecl schedule_task_proc(void *arg)
+{
+    struct schedule_task_data *data = arg;
+
+    if (InterlockedIncrement(&data->count) == 210)
+        SetEvent(data->event);
+}
+
+static void __cdecl schedule_nested_task_proc(void *arg)
+{
+    struct schedule_task_data *data = arg;
+    int i;
+
+    ok(p_CurrentScheduler_Get() == data->scheduler, "task is not running on its scheduler\n");
+    for (i = 0; i < 10; i++)
+        call_func3(data->scheduler->vtable->ScheduleTask, data->scheduler, schedule_task_proc, data);
+    schedule_task_proc(data);
+}
+
 static void test_Scheduler(void)
 {
+    struct schedule_task_data task_data;
     Scheduler *scheduler, *current_scheduler;
     SchedulerPolicy policy;
     unsigned int i;
@@ -986,6 +1013,21 @@ static void test_Scheduler(void)
     i = call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler);
     ok(i == 1, "Scheduler::GetNumberOfVirtualProcessors() = %u\n", i);
     call_func1(scheduler->vtable->Release, scheduler);
+
+    call_func3(p_SchedulerPolicy_SetConcurrencyLimits, &policy, 1, 4);
+    scheduler = p_Scheduler_Create(&policy);
+    ok(scheduler != NULL, "Scheduler::Create() = NULL\n");
+
+    task_data.scheduler = scheduler;
+    task_data.count = 0;
+    task_data.event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    for (i = 0; i < 100; i++)
+        call_func3(scheduler->vtable->ScheduleTask, scheduler, schedule_task_proc, &task_data);
+    for (i = 0; i < 10; i++)
+        call_func3(scheduler->vtable->ScheduleTask, scheduler, schedule_nested_task_proc, &task_data);
+    ok(!WaitForSingleObject(task_data.event, 5000), "tasks did not complete, count %d\n", task_data.count);
+    CloseHandle(task_data.event);
+    call_func1(scheduler->vtable->Release, scheduler);
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
 
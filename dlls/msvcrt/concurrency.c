@@ -89,11 +89,14 @@ struct scheduler_list {
     struct scheduler_list *next;
 };
 
+struct scheduler_vproc;
+
 typedef struct {
     Context context;
     struct scheduler_list scheduler;
     unsigned int id;
     union allocator_cache_entry *allocator_cache[8];
+    struct scheduler_vproc *vproc;
 } ExternalContextBase;
 extern const vtable_ptr ExternalContextBase_vtable;
 static void ExternalContextBase_ctor(ExternalContextBase*);
@@ -135,9 +138,46 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    struct scheduler_pool *pool;
 } ThreadScheduler;
 extern const vtable_ptr ThreadScheduler_vtable;
 
+struct scheduler_task
+{
+    void (__cdecl *proc)(void*);
+    void *data;
+    ThreadScheduler *scheduler;
+};
+
+/* Each virtual processor owns a task queue and at most one worker thread.
+ * The worker takes its own tasks in LIFO order and steals the oldest tasks
+ * of the other virtual processors when its queue is empty. */
+struct scheduler_vproc
+{
+    struct scheduler_pool *pool;
+    unsigned int id;
+    LONG active;
+    CRITICAL_SECTION cs;
+    struct scheduler_task *tasks;
+    unsigned int head;
+    unsigned int count;
+    unsigned int size;
+};
+
+struct scheduler_pool
+{
+    LONG ref;
+    BOOL shutdown;
+    LONG signal;
+    LONG idle;
+    LONG workers;
+    LONG min_workers;
+    LONG next_vproc;
+    Scheduler *scheduler; /* owner, not referenced */
+    unsigned int vproc_no;
+    struct scheduler_vproc vprocs[1];
+};
+
 typedef struct {
     Scheduler *scheduler;
 } _Scheduler;
@@ -620,10 +660,8 @@ static Context* try_get_current_context(void)
     return TlsGetValue(context_tls_index);
 }
 
-static Context* get_current_context(void)
+static void alloc_context_tls(void)
 {
-    Context *ret;
-
     if (context_tls_index == TLS_OUT_OF_INDEXES) {
         int tls_index = TlsAlloc();
         if (tls_index == TLS_OUT_OF_INDEXES) {
@@ -636,7 +674,13 @@ static Context* get_current_context(void)
         if(InterlockedCompareExchange(&context_tls_index, tls_index, TLS_OUT_OF_INDEXES) != TLS_OUT_OF_INDEXES)
             TlsFree(tls_index);
     }
+}
+
+static Context* get_current_context(void)
+{
+    Context *ret;
 
+    alloc_context_tls();
     ret = TlsGetValue(context_tls_index);
     if (!ret) {
         ExternalContextBase *context = operator_new(sizeof(ExternalContextBase));
@@ -756,8 +800,8 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->vproc ? this->vproc->id : -1;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
@@ -1095,6 +1139,284 @@ void __thiscall SchedulerPolicy_dtor(SchedulerPolicy *this)
     operator_delete(this->policy_container);
 }
 
+static void scheduler_pool_release(struct scheduler_pool *pool)
+{
+    unsigned int i;
+
+    if(InterlockedDecrement(&pool->ref))
+        return;
+
+    for(i=0; i<pool->vproc_no; i++) {
+        if(pool->vprocs[i].count)
+            WARN("dropping %u tasks\n", pool->vprocs[i].count);
+        pool->vprocs[i].cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection(&pool->vprocs[i].cs);
+        operator_delete(pool->vprocs[i].tasks);
+    }
+    operator_delete(pool);
+}
+
+static void vproc_push_task(struct scheduler_vproc *vproc, const struct scheduler_task *task)
+{
+    struct scheduler_task *tasks;
+    unsigned int i, size;
+
+    EnterCriticalSection(&vproc->cs);
+    while(vproc->count == vproc->size) {
+        size = vproc->size ? vproc->size * 2 : 16;
+        LeaveCriticalSection(&vproc->cs);
+        tasks = operator_new(size * sizeof(*tasks));
+        EnterCriticalSection(&vproc->cs);
+
+        if(vproc->size >= size) {
+            operator_delete(tasks);
+            continue;
+        }
+        for(i=0; i<vproc->count; i++)
+            tasks[i] = vproc->tasks[(vproc->head + i) % vproc->size];
+        operator_delete(vproc->tasks);
+        vproc->tasks = tasks;
+        vproc->size = size;
+        vproc->head = 0;
+    }
+    vproc->tasks[(vproc->head + vproc->count++) % vproc->size] = *task;
+    LeaveCriticalSection(&vproc->cs);
+}
+
+static BOOL vproc_pop_task(struct scheduler_vproc *vproc, struct scheduler_task *task, BOOL steal)
+{
+    BOOL ret = FALSE;
+
+    if(!*(volatile unsigned int *)&vproc->count)
+        return FALSE;
+
+    EnterCriticalSection(&vproc->cs);
+    if(vproc->count) {
+        if(steal) {
+            *task = vproc->tasks[vproc->head];
+            vproc->head = (vproc->head + 1) % vproc->size;
+        } else {
+            *task = vproc->tasks[(vproc->head + vproc->count - 1) % vproc->size];
+        }
+        vproc->count--;
+        ret = TRUE;
+    }
+    LeaveCriticalSection(&vproc->cs);
+    return ret;
+}
+
+static BOOL scheduler_pool_get_task(struct scheduler_pool *pool,
+        struct scheduler_vproc *vproc, struct scheduler_task *task)
+{
+    unsigned int i;
+
+    if(vproc_pop_task(vproc, task, FALSE))
+        return TRUE;
+    for(i=1; i<pool->vproc_no; i++) {
+        if(vproc_pop_task(&pool->vprocs[(vproc->id + i) % pool->vproc_no], task, TRUE))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void scheduler_run_task(ExternalContextBase *context, struct scheduler_task *task)
+{
+    Scheduler *prev = context->scheduler.scheduler;
+
+    context->scheduler.scheduler = &task->scheduler->scheduler;
+    task->proc(task->data);
+    context->scheduler.scheduler = prev;
+    call_Scheduler_Release(&task->scheduler->scheduler);
+}
+
+static void scheduler_pool_start_worker(struct scheduler_pool*);
+
+static BOOL scheduler_pool_has_tasks(struct scheduler_pool *pool)
+{
+    unsigned int i;
+
+    for(i=0; i<pool->vproc_no; i++) {
+        if(*(volatile unsigned int *)&pool->vprocs[i].count)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Worker contexts belong to the scheduler owning the pool instead of
+ * attaching the default scheduler. They don't hold a reference, the
+ * queued tasks keep the scheduler alive while they run. */
+static ExternalContextBase* create_worker_context(struct scheduler_vproc *vproc)
+{
+    ExternalContextBase *context = operator_new(sizeof(*context));
+
+    memset(context, 0, sizeof(*context));
+    context->context.vtable = &ExternalContextBase_vtable;
+    context->id = InterlockedIncrement(&context_id);
+    context->scheduler.scheduler = vproc->pool->scheduler;
+    context->vproc = vproc;
+
+    alloc_context_tls();
+    TlsSetValue(context_tls_index, context);
+    return context;
+}
+
+static DWORD WINAPI scheduler_worker_proc(void *arg)
+{
+    struct scheduler_vproc *vproc = arg;
+    struct scheduler_pool *pool = vproc->pool;
+    ExternalContextBase *context = create_worker_context(vproc);
+    struct scheduler_task task;
+    LARGE_INTEGER timeout;
+    BOOL retired = FALSE;
+    HMODULE module;
+    NTSTATUS status;
+    LONG signal, workers;
+
+    TRACE("starting worker for virtual processor %u\n", vproc->id);
+
+    timeout.QuadPart = -50000000; /* 5 seconds */
+
+    for(;;) {
+        signal = *(volatile LONG *)&pool->signal;
+
+        if(scheduler_pool_get_task(pool, vproc, &task)) {
+            scheduler_run_task(context, &task);
+            continue;
+        }
+        if(pool->shutdown)
+            break;
+
+        InterlockedIncrement(&pool->idle);
+        status = RtlWaitOnAddress(&pool->signal, &signal, sizeof(signal), &timeout);
+        InterlockedDecrement(&pool->idle);
+        if(status != STATUS_TIMEOUT)
+            continue;
+
+        /* let surplus workers go away, but recheck the queues after
+         * leaving so that a task scheduled meanwhile is not stranded */
+        workers = pool->workers;
+        if(workers > pool->min_workers &&
+                InterlockedCompareExchange(&pool->workers, workers - 1, workers) == workers) {
+            if(!scheduler_pool_get_task(pool, vproc, &task)) {
+                retired = TRUE;
+                break;
+            }
+            InterlockedIncrement(&pool->workers);
+            scheduler_run_task(context, &task);
+        }
+    }
+
+    TRACE("stopping worker for virtual processor %u\n", vproc->id);
+
+    context->vproc = NULL;
+    context->scheduler.scheduler = NULL;
+    if(!retired)
+        InterlockedDecrement(&pool->workers);
+    InterlockedExchange(&vproc->active, FALSE);
+    /* a task scheduled while this worker was leaving may have found its
+     * virtual processor still active and not started another worker */
+    if(!pool->shutdown && scheduler_pool_has_tasks(pool))
+        scheduler_pool_start_worker(pool);
+    scheduler_pool_release(pool);
+
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            (const WCHAR *)scheduler_worker_proc, &module);
+    FreeLibraryAndExitThread(module, 0);
+    return 0;
+}
+
+static void scheduler_pool_start_worker(struct scheduler_pool *pool)
+{
+    struct scheduler_vproc *vproc;
+    HMODULE module;
+    HANDLE thread;
+    unsigned int i;
+
+    for(i=0; i<pool->vproc_no; i++) {
+        vproc = &pool->vprocs[i];
+        if(InterlockedCompareExchange(&vproc->active, TRUE, FALSE))
+            continue;
+
+        InterlockedIncrement(&pool->ref);
+        InterlockedIncrement(&pool->workers);
+        GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                (const WCHAR *)scheduler_worker_proc, &module);
+        thread = CreateThread(NULL, 0, scheduler_worker_proc, vproc, 0, NULL);
+        if(!thread) {
+            ERR("failed to create worker thread: %u\n", GetLastError());
+            FreeLibrary(module);
+            InterlockedDecrement(&pool->workers);
+            InterlockedExchange(&vproc->active, FALSE);
+            scheduler_pool_release(pool);
+            return;
+        }
+        CloseHandle(thread);
+        return;
+    }
+}
+
+static struct scheduler_pool* ThreadScheduler_get_pool(ThreadScheduler *this)
+{
+    struct scheduler_pool *pool;
+    unsigned int i;
+
+    if(this->pool)
+        return this->pool;
+
+    pool = operator_new(FIELD_OFFSET(struct scheduler_pool, vprocs[this->virt_proc_no]));
+    memset(pool, 0, FIELD_OFFSET(struct scheduler_pool, vprocs[this->virt_proc_no]));
+    pool->ref = 1;
+    pool->scheduler = &this->scheduler;
+    pool->vproc_no = this->virt_proc_no;
+    pool->min_workers = min(SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency), pool->vproc_no);
+    for(i=0; i<pool->vproc_no; i++) {
+        pool->vprocs[i].pool = pool;
+        pool->vprocs[i].id = i;
+        InitializeCriticalSectionAndSpinCount(&pool->vprocs[i].cs, 4000);
+        pool->vprocs[i].cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": scheduler_vproc");
+    }
+
+    EnterCriticalSection(&this->cs);
+    if(!this->pool) {
+        this->pool = pool;
+        pool = NULL;
+    }
+    LeaveCriticalSection(&this->cs);
+
+    if(pool)
+        scheduler_pool_release(pool);
+    return this->pool;
+}
+
+static void ThreadScheduler_schedule(ThreadScheduler *this,
+        void (__cdecl *proc)(void*), void *data)
+{
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+    struct scheduler_pool *pool = ThreadScheduler_get_pool(this);
+    struct scheduler_vproc *vproc;
+    struct scheduler_task task;
+
+    task.proc = proc;
+    task.data = data;
+    task.scheduler = this;
+
+    /* tasks created by a worker stay on its virtual processor */
+    if(context && context->context.vtable == &ExternalContextBase_vtable &&
+            context->vproc && context->vproc->pool == pool)
+        vproc = context->vproc;
+    else
+        vproc = &pool->vprocs[(unsigned int)InterlockedIncrement(&pool->next_vproc) % pool->vproc_no];
+
+    InterlockedIncrement(&this->ref);
+    vproc_push_task(vproc, &task);
+
+    InterlockedIncrement(&pool->signal);
+    if(pool->idle)
+        RtlWakeAddressSingle(&pool->signal);
+    else if(pool->workers < pool->vproc_no)
+        scheduler_pool_start_worker(pool);
+}
+
 static void ThreadScheduler_dtor(ThreadScheduler *this)
 {
     int i;
@@ -1106,6 +1428,14 @@ static void ThreadScheduler_dtor(ThreadScheduler *this)
         SetEvent(this->shutdown_events[i]);
     operator_delete(this->shutdown_events);
 
+    if(this->pool) {
+        this->pool->scheduler = NULL;
+        this->pool->shutdown = TRUE;
+        InterlockedIncrement(&this->pool->signal);
+        RtlWakeAddressAll(&this->pool->signal);
+        scheduler_pool_release(this->pool);
+    }
+
     this->cs.DebugInfo->Spare[0] = 0;
     DeleteCriticalSection(&this->cs);
 }
@@ -1221,14 +1551,16 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
 void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
 {
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
+    TRACE("(%p %p %p %p): placement ignored\n", this, proc, data, placement);
+    ThreadScheduler_schedule(this, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    TRACE("(%p %p %p)\n", this, proc, data);
+    ThreadScheduler_schedule(this, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -1278,6 +1610,7 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
 
     this->shutdown_count = this->shutdown_size = 0;
     this->shutdown_events = NULL;
+    this->pool = NULL;
 
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
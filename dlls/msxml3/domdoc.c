@@ -83,6 +83,7 @@ typedef struct {
     LONG selectNsStr_len;
     BOOL XPath;
     IUri *uri;
+    struct list queries; /* compiled selection queries, depend on selectNsList */
 } domdoc_properties;
 
 typedef struct ConnectionPoint ConnectionPoint;
@@ -239,6 +240,11 @@ void set_xpathmode(xmlDocPtr doc, BOOL xpath)
     properties_from_xmlDocPtr(doc)->XPath = xpath;
 }
 
+struct list *xmldoc_query_cache(xmlDocPtr doc)
+{
+    return &properties_from_xmlDocPtr(doc)->queries;
+}
+
 int registerNamespaces(xmlXPathContextPtr ctxt)
 {
     int n = 0;
@@ -299,6 +305,8 @@ static domdoc_properties *create_properties(MSXML_VERSION version)
     /* document uri */
     properties->uri = NULL;
 
+    list_init(&properties->queries);
+
     return properties;
 }
 
@@ -337,6 +345,8 @@ static domdoc_properties* copy_properties(domdoc_properties const* properties)
         pcopy->uri = properties->uri;
         if (pcopy->uri)
             IUri_AddRef(pcopy->uri);
+
+        list_init(&pcopy->queries);
     }
 
     return pcopy;
@@ -371,6 +381,7 @@ static void properties_release(domdoc_properties *properties)
         if (properties->schemaCache)
             IXMLDOMSchemaCollection2_Release(properties->schemaCache);
         clear_selectNsList(&properties->selectNsList);
+        clear_query_cache(&properties->queries);
         heap_free((xmlChar*)properties->selectNsStr);
         if (properties->uri)
             IUri_Release(properties->uri);
@@ -3073,6 +3084,8 @@ static HRESULT WINAPI domdoc_setProperty(
 
         pNsList = &(This->properties->selectNsList);
         clear_selectNsList(pNsList);
+        /* XSLPattern queries are translated depending on registered prefixes */
+        clear_query_cache(&This->properties->queries);
         heap_free(nsStr);
         nsStr = xmlchar_from_wchar(bstr);
 
@@ -207,6 +207,8 @@ extern void wineXmlCallbackError(char const* caller, xmlErrorPtr err) DECLSPEC_H
 extern BOOL is_preserving_whitespace(xmlNodePtr node) DECLSPEC_HIDDEN;
 extern BOOL is_xpathmode(const xmlDocPtr doc) DECLSPEC_HIDDEN;
 extern void set_xpathmode(xmlDocPtr doc, BOOL xpath) DECLSPEC_HIDDEN;
+extern struct list *xmldoc_query_cache(xmlDocPtr doc) DECLSPEC_HIDDEN;
+extern void clear_query_cache(struct list *cache) DECLSPEC_HIDDEN;
 
 extern void init_xmlnode(xmlnode*,xmlNodePtr,IXMLDOMNode*,dispex_static_data_t*) DECLSPEC_HIDDEN;
 extern void destroy_xmlnode(xmlnode*) DECLSPEC_HIDDEN;
@@ -151,6 +151,8 @@ typedef struct
     UINT code_page;
     UINT utf16_total;   /* total number of bytes written since last buffer reinitialization */
     struct list blocks; /* only used when output was not set, for BSTR case */
+    WCHAR *pending;     /* utf16 data waiting to be encoded, only used for a stream with multibyte code page */
+    unsigned int pending_len;
 } output_buffer;
 
 typedef struct
@@ -266,14 +268,20 @@ static xml_encoding parse_encoding_name(const WCHAR *encoding)
     return XmlEncoding_Unknown;
 }
 
-static HRESULT init_encoded_buffer(encoded_buffer *buffer)
+/* size of the initial block, and the number of characters encoded at once for a stream */
+#define OUTPUT_BLOCK_SIZE 0x1000
+/* accumulation blocks grow up to this size when writing to a BSTR */
+#define OUTPUT_BLOCK_MAX_SIZE 0x100000
+/* a single utf16 character never takes more than 3 bytes in any supported code page */
+#define MAX_ENCODED_CHAR_SIZE 3
+
+static HRESULT init_encoded_buffer(encoded_buffer *buffer, unsigned int size)
 {
-    const int initial_len = 0x1000;
-    buffer->data = heap_alloc(initial_len);
+    buffer->data = heap_alloc(size);
     if (!buffer->data) return E_OUTOFMEMORY;
 
     memset(buffer->data, 0, 4);
-    buffer->allocated = initial_len;
+    buffer->allocated = size;
     buffer->written = 0;
 
     return S_OK;
@@ -308,12 +316,14 @@ static HRESULT init_output_buffer(xml_encoding encoding, output_buffer *buffer)
     if (hr != S_OK)
         return hr;
 
-    hr = init_encoded_buffer(&buffer->encoded);
+    hr = init_encoded_buffer(&buffer->encoded, OUTPUT_BLOCK_SIZE);
     if (hr != S_OK)
         return hr;
 
     list_init(&buffer->blocks);
     buffer->utf16_total = 0;
+    buffer->pending = NULL;
+    buffer->pending_len = 0;
 
     return S_OK;
 }
@@ -323,6 +333,7 @@ static void free_output_buffer(output_buffer *buffer)
     encoded_buffer *cur, *cur2;
 
     free_encoded_buffer(&buffer->encoded);
+    heap_free(buffer->pending);
 
     LIST_FOR_EACH_ENTRY_SAFE(cur, cur2, &buffer->blocks, encoded_buffer, entry)
     {
@@ -332,17 +343,38 @@ static void free_output_buffer(output_buffer *buffer)
     }
 }
 
-static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
+/* Converts pending utf16 data with a single WideCharToMultiByte() call and passes it to the stream.
+   Unless this is a final flush a trailing high surrogate is kept, so that pairs are never split
+   between two conversions. */
+static HRESULT encode_pending_output(mxwriter *writer, BOOL final)
 {
     output_buffer *buffer = &writer->buffer;
-    encoded_buffer *buff;
-    unsigned int written;
-    int src_len;
+    encoded_buffer *buff = &buffer->encoded;
+    unsigned int len = buffer->pending_len;
+    ULONG written;
+    int length;
 
-    if (!len || !*data)
+    if (!final && len && IS_HIGH_SURROGATE(buffer->pending[len - 1]))
+        len--;
+    if (!len)
         return S_OK;
 
-    src_len = len == -1 ? lstrlenW(data) : len;
+    length = WideCharToMultiByte(buffer->code_page, 0, buffer->pending, len, buff->data, buff->allocated, NULL, NULL);
+    IStream_Write(writer->dest, buff->data, length, &written);
+
+    buffer->pending_len -= len;
+    if (buffer->pending_len)
+        buffer->pending[0] = buffer->pending[len];
+
+    return S_OK;
+}
+
+static HRESULT write_output_data(mxwriter *writer, const WCHAR *data, unsigned int src_len)
+{
+    output_buffer *buffer = &writer->buffer;
+    encoded_buffer *buff;
+    unsigned int written;
+
     if (writer->dest)
     {
         buff = &buffer->encoded;
@@ -379,43 +411,34 @@ static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
         }
         else
         {
-            unsigned int avail = buff->allocated - buff->written;
-            int length;
-
-            length = WideCharToMultiByte(buffer->code_page, 0, data, src_len, NULL, 0, NULL, NULL);
-            if (avail >= length)
+            /* Keep utf16 data as is and encode it in large chunks once the pending buffer
+               is full, instead of converting every small piece twice (to get the length
+               and to actually convert it). */
+            if (!buffer->pending)
             {
-                length = WideCharToMultiByte(buffer->code_page, 0, data, src_len, buff->data + buff->written, length, NULL, NULL);
-                buff->written += length;
+                char *ptr;
+
+                if (!(ptr = heap_realloc(buff->data, OUTPUT_BLOCK_SIZE * MAX_ENCODED_CHAR_SIZE)))
+                    return E_OUTOFMEMORY;
+                buff->data = ptr;
+                buff->allocated = OUTPUT_BLOCK_SIZE * MAX_ENCODED_CHAR_SIZE;
+                if (!(buffer->pending = heap_alloc(OUTPUT_BLOCK_SIZE * sizeof(WCHAR))))
+                    return E_OUTOFMEMORY;
             }
-            else
-            {
-                /* drain what we go so far */
-                if (buff->written)
-                {
-                    IStream_Write(writer->dest, buff->data, buff->written, &written);
-                    buff->written = 0;
-                    avail = buff->allocated;
-                }
 
-                if (avail >= length)
-                {
-                    length = WideCharToMultiByte(buffer->code_page, 0, data, src_len, buff->data + buff->written, length, NULL, NULL);
-                    buff->written += length;
-                }
-                else
-                {
-                    char *mb;
+            while (src_len)
+            {
+                unsigned int avail;
 
-                    /* if current chunk is larger than total buffer size, convert it at once using temporary allocated buffer */
-                    mb = heap_alloc(length);
-                    if (!mb)
-                        return E_OUTOFMEMORY;
+                if (buffer->pending_len == OUTPUT_BLOCK_SIZE)
+                    encode_pending_output(writer, FALSE);
 
-                    length = WideCharToMultiByte(buffer->code_page, 0, data, src_len, mb, length, NULL, NULL);
-                    IStream_Write(writer->dest, mb, length, &written);
-                    heap_free(mb);
-                }
+                avail = OUTPUT_BLOCK_SIZE - buffer->pending_len;
+                written = min(avail, src_len);
+                memcpy(buffer->pending + buffer->pending_len, data, written * sizeof(WCHAR));
+                buffer->pending_len += written;
+                data += written;
+                src_len -= written;
             }
         }
     }
@@ -425,6 +448,7 @@ static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
        - fill a buffer already allocated as part of output buffer;
        - when current buffer is full, allocate another one and switch to it; buffers themselves never grow,
          but are linked together, with head pointing to first allocated buffer after initial one got filled;
+         every new buffer is twice as large as the previous one, so large documents need few allocations;
        - later during get_output() contents are concatenated by copying one after another to destination BSTR buffer,
          that's returned to the client. */
     else
@@ -444,6 +468,7 @@ static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
             if (avail)
             {
                 memcpy(buff->data + buff->written, data, written);
+                data += written / sizeof(WCHAR);
                 buff->written += written;
                 buffer->utf16_total += written;
                 src_len -= written;
@@ -455,7 +480,8 @@ static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
                 encoded_buffer *next = heap_alloc(sizeof(*next));
                 HRESULT hr;
 
-                if (FAILED(hr = init_encoded_buffer(next))) {
+                if (!next) return E_OUTOFMEMORY;
+                if (FAILED(hr = init_encoded_buffer(next, min(buff->allocated * 2, OUTPUT_BLOCK_MAX_SIZE)))) {
                     heap_free(next);
                     return hr;
                 }
@@ -469,6 +495,14 @@ static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
     return S_OK;
 }
 
+static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
+{
+    if (!len || !*data)
+        return S_OK;
+
+    return write_output_data(writer, data, len == -1 ? lstrlenW(data) : len);
+}
+
 static HRESULT write_output_buffer_quoted(mxwriter *writer, const WCHAR *data, int len)
 {
     write_output_buffer(writer, quotW, 1);
@@ -484,6 +518,7 @@ static void close_output_buffer(mxwriter *writer)
     encoded_buffer *cur, *cur2;
 
     heap_free(writer->buffer.encoded.data);
+    heap_free(writer->buffer.pending);
 
     LIST_FOR_EACH_ENTRY_SAFE(cur, cur2, &writer->buffer.blocks, encoded_buffer, entry)
     {
@@ -492,82 +527,78 @@ static void close_output_buffer(mxwriter *writer)
         heap_free(cur);
     }
 
-    init_encoded_buffer(&writer->buffer.encoded);
+    init_encoded_buffer(&writer->buffer.encoded, OUTPUT_BLOCK_SIZE);
     get_code_page(writer->xml_enc, &writer->buffer.code_page);
     writer->buffer.utf16_total = 0;
+    writer->buffer.pending = NULL;
+    writer->buffer.pending_len = 0;
     list_init(&writer->buffer.blocks);
 }
 
-/* Escapes special characters like:
+/* Writes a string escaping special characters like:
    '<' -> "&lt;"
    '&' -> "&amp;"
    '"' -> "&quot;"
    '>' -> "&gt;"
 
-   On call 'len' contains a length of 'str' in chars or -1 if it's null terminated.
-   After a call it's updated with actual new length if it wasn't -1 initially.
+   Runs of characters that don't need escaping are passed to the output buffer directly,
+   so no intermediate copy of the string is made.
 */
-static WCHAR *get_escaped_string(const WCHAR *str, escape_mode mode, int *len)
+static HRESULT write_output_buffer_escaped(mxwriter *writer, const WCHAR *str, int len, escape_mode mode)
 {
     static const WCHAR ltW[]    = {'&','l','t',';'};
     static const WCHAR ampW[]   = {'&','a','m','p',';'};
     static const WCHAR equotW[] = {'&','q','u','o','t',';'};
     static const WCHAR gtW[]    = {'&','g','t',';'};
 
-    const int default_alloc = 100;
-    const int grow_thresh = 10;
-    int p = *len, conv_len;
-    WCHAR *ptr, *ret;
+    const WCHAR *run = str, *end;
+    HRESULT hr;
 
-    /* default buffer size to something if length is unknown */
-    conv_len = max(2**len, default_alloc);
-    ptr = ret = heap_alloc(conv_len*sizeof(WCHAR));
+    if (!len || !*str)
+        return S_OK;
 
-    while (p)
+    for (end = str + len; str < end; str++)
     {
-        if (ptr - ret > conv_len - grow_thresh)
-        {
-            int written = ptr - ret;
-            conv_len *= 2;
-            ptr = ret = heap_realloc(ret, conv_len*sizeof(WCHAR));
-            ptr += written;
-        }
+        const WCHAR *entity;
+        int entity_len;
 
         switch (*str)
         {
         case '<':
-            memcpy(ptr, ltW, sizeof(ltW));
-            ptr += ARRAY_SIZE(ltW);
+            entity = ltW;
+            entity_len = ARRAY_SIZE(ltW);
             break;
         case '&':
-            memcpy(ptr, ampW, sizeof(ampW));
-            ptr += ARRAY_SIZE(ampW);
+            entity = ampW;
+            entity_len = ARRAY_SIZE(ampW);
             break;
         case '>':
-            memcpy(ptr, gtW, sizeof(gtW));
-            ptr += ARRAY_SIZE(gtW);
+            entity = gtW;
+            entity_len = ARRAY_SIZE(gtW);
             break;
         case '"':
             if (mode == EscapeValue)
             {
-                memcpy(ptr, equotW, sizeof(equotW));
-                ptr += ARRAY_SIZE(equotW);
+                entity = equotW;
+                entity_len = ARRAY_SIZE(equotW);
                 break;
             }
             /* fallthrough for text mode */
         default:
-            *ptr++ = *str;
-            break;
+            continue;
         }
 
-        str++;
-        p--;
+        if (str > run && FAILED(hr = write_output_data(writer, run, str - run)))
+            return hr;
+        if (FAILED(hr = write_output_data(writer, entity, entity_len)))
+            return hr;
+        run = str + 1;
     }
 
-    *len = ptr-ret;
-    *++ptr = 0;
+    if (str > run)
+        return write_output_data(writer, run, str - run);
 
-    return ret;
+    return S_OK;
 }
 
 static void write_prolog_buffer(mxwriter *writer)
@@ -613,6 +644,9 @@ static HRESULT write_data_to_stream(mxwriter *writer)
     if (!writer->dest)
         return S_OK;
 
+    if (writer->buffer.pending_len)
+        return encode_pending_output(writer, TRUE);
+
     if (buffer->written == 0)
     {
         if (writer->xml_enc == XmlEncoding_UTF8)
@@ -1279,9 +1313,9 @@ static void mxwriter_write_attribute(mxwriter *writer, const WCHAR *qname, int q
 
     if (escape)
     {
-        WCHAR *escaped = get_escaped_string(value, EscapeValue, &value_len);
-        write_output_buffer_quoted(writer, escaped, value_len);
-        heap_free(escaped);
+        write_output_buffer(writer, quotW, 1);
+        write_output_buffer_escaped(writer, value, value_len, EscapeValue);
+        write_output_buffer(writer, quotW, 1);
     }
     else
         write_output_buffer_quoted(writer, value, value_len);
@@ -1414,14 +1448,7 @@ static HRESULT WINAPI SAXContentHandler_characters(
         if (This->cdata || This->props[MXWriter_DisableEscaping] == VARIANT_TRUE)
             write_output_buffer(This, chars, nchars);
         else
-        {
-            int len = nchars;
-            WCHAR *escaped;
-
-            escaped = get_escaped_string(chars, EscapeText, &len);
-            write_output_buffer(This, escaped, len);
-            heap_free(escaped);
-        }
+            write_output_buffer_escaped(This, chars, nchars, EscapeText);
     }
 
     return S_OK;
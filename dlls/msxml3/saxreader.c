@@ -152,6 +152,14 @@ struct bstrpool
     unsigned int len;
 };
 
+struct name_entry
+{
+    struct name_entry *next;
+    unsigned int hash;
+    BSTR name;
+    char key[1]; /* utf-8 name, "prefix:local" for prefixed names */
+};
+
 typedef struct
 {
     BSTR prefix;
@@ -306,6 +314,11 @@ typedef struct
     BOOL vbInterface;
     struct list elements;
 
+    /* cache of element and attribute names, namespace prefixes and uris */
+    struct name_entry **names;
+    unsigned int names_size;
+    unsigned int names_count;
+
     BSTR namespaceUri;
     int attr_alloc_count;
     int attr_count;
@@ -442,26 +455,134 @@ static BOOL is_namespaces_enabled(const saxreader *reader)
     return (reader->version < MSXML4) || (reader->features & Namespaces);
 }
 
-static BSTR build_qname(BSTR prefix, BSTR local)
+static unsigned int hash_name(const xmlChar *prefix, const xmlChar *local)
+{
+    unsigned int hash = 0;
+
+    if (prefix && *prefix)
+    {
+        while (*prefix) hash = hash * 31 + *prefix++;
+        hash = hash * 31 + ':';
+    }
+    while (*local) hash = hash * 31 + *local++;
+
+    return hash;
+}
+
+static BOOL name_matches(const char *key, const xmlChar *prefix, const xmlChar *local)
 {
     if (prefix && *prefix)
     {
-        BSTR qname = SysAllocStringLen(NULL, SysStringLen(prefix) + SysStringLen(local) + 1);
-        WCHAR *ptr;
+        size_t len = strlen((const char *)prefix);
 
-        ptr = qname;
-        lstrcpyW(ptr, prefix);
-        ptr += SysStringLen(prefix);
-        *ptr++ = ':';
-        lstrcpyW(ptr, local);
-        return qname;
+        if (strncmp(key, (const char *)prefix, len) || key[len] != ':') return FALSE;
+        key += len + 1;
     }
-    else
-        return SysAllocString(local);
+
+    return !strcmp(key, (const char *)local);
+}
+
+static BOOL grow_names(saxlocator *locator)
+{
+    unsigned int size = locator->names_size ? locator->names_size * 2 : 64, i;
+    struct name_entry **names, *entry, *next;
+
+    if (!(names = heap_alloc_zero(size * sizeof(*names))))
+        return FALSE;
+
+    for (i = 0; i < locator->names_size; i++)
+    {
+        for (entry = locator->names[i]; entry; entry = next)
+        {
+            next = entry->next;
+            entry->next = names[entry->hash & (size - 1)];
+            names[entry->hash & (size - 1)] = entry;
+        }
+    }
+
+    heap_free(locator->names);
+    locator->names = names;
+    locator->names_size = size;
+    return TRUE;
+}
+
+/* VB handlers get names by reference and may replace them, so they are given
+   copies instead of the strings owned by the name cache. */
+static BSTR copy_name(BSTR name)
+{
+    return name ? SysAllocStringLen(name, SysStringLen(name)) : NULL;
+}
+
+/* Returns a name string that stays valid and is shared between all events of the parse,
+   so that repeated element and attribute names are converted and allocated only once.
+   Strings returned here are owned by the locator and should never be freed by callers. */
+static BSTR get_name(saxlocator *locator, const xmlChar *prefix, const xmlChar *local)
+{
+    unsigned int hash, prefix_len = 0, len;
+    struct name_entry *entry;
+
+    if (!local) local = (const xmlChar *)"";
+
+    hash = hash_name(prefix, local);
+    if (locator->names)
+    {
+        for (entry = locator->names[hash & (locator->names_size - 1)]; entry; entry = entry->next)
+            if (entry->hash == hash && name_matches(entry->key, prefix, local))
+                return entry->name;
+    }
+
+    if (locator->names_count >= locator->names_size / 4 * 3 && !grow_names(locator))
+        return NULL;
+
+    if (prefix && *prefix) prefix_len = strlen((const char *)prefix) + 1;
+    len = strlen((const char *)local);
+
+    if (!(entry = heap_alloc(FIELD_OFFSET(struct name_entry, key[prefix_len + len + 1]))))
+        return NULL;
+
+    if (prefix_len)
+    {
+        memcpy(entry->key, prefix, prefix_len - 1);
+        entry->key[prefix_len - 1] = ':';
+    }
+    memcpy(entry->key + prefix_len, local, len + 1);
+
+    if (!(entry->name = bstr_from_xmlChar((const xmlChar *)entry->key)))
+    {
+        heap_free(entry);
+        return NULL;
+    }
+
+    entry->hash = hash;
+    entry->next = locator->names[hash & (locator->names_size - 1)];
+    locator->names[hash & (locator->names_size - 1)] = entry;
+    locator->names_count++;
+
+    return entry->name;
 }
 
-static element_entry* alloc_element_entry(const xmlChar *local, const xmlChar *prefix, int nb_ns,
-    const xmlChar **namespaces)
+static void free_names(saxlocator *locator)
+{
+    struct name_entry *entry, *next;
+    unsigned int i;
+
+    for (i = 0; i < locator->names_size; i++)
+    {
+        for (entry = locator->names[i]; entry; entry = next)
+        {
+            next = entry->next;
+            SysFreeString(entry->name);
+            heap_free(entry);
+        }
+    }
+
+    heap_free(locator->names);
+    locator->names = NULL;
+    locator->names_size = locator->names_count = 0;
+}
+
+static element_entry* alloc_element_entry(saxlocator *locator, const xmlChar *local, const xmlChar *prefix,
+    int nb_ns, const xmlChar **namespaces)
 {
     element_entry *ret;
     int i;
@@ -469,35 +590,24 @@ static element_entry* alloc_element_entry(const xmlChar *local, const xmlChar *p
     ret = heap_alloc(sizeof(*ret));
     if (!ret) return ret;
 
-    ret->local  = bstr_from_xmlChar(local);
-    ret->prefix = bstr_from_xmlChar(prefix);
-    ret->qname  = build_qname(ret->prefix, ret->local);
+    ret->local  = get_name(locator, NULL, local);
+    ret->prefix = get_name(locator, NULL, prefix);
+    ret->qname  = get_name(locator, prefix, local);
     ret->ns = nb_ns ? heap_alloc(nb_ns*sizeof(ns)) : NULL;
     ret->ns_count = nb_ns;
 
     for (i=0; i < nb_ns; i++)
     {
-        ret->ns[i].prefix = bstr_from_xmlChar(namespaces[2*i]);
-        ret->ns[i].uri = bstr_from_xmlChar(namespaces[2*i+1]);
+        ret->ns[i].prefix = get_name(locator, NULL, namespaces[2*i]);
+        ret->ns[i].uri = get_name(locator, NULL, namespaces[2*i+1]);
     }
 
     return ret;
 }
 
+/* names are owned by the locator name cache */
 static void free_element_entry(element_entry *element)
 {
-    int i;
-
-    for (i=0; i<element->ns_count;i++)
-    {
-        SysFreeString(element->ns[i].prefix);
-        SysFreeString(element->ns[i].uri);
-    }
-
-    SysFreeString(element->prefix);
-    SysFreeString(element->local);
-    SysFreeString(element->qname);
-
     heap_free(element->ns);
     heap_free(element);
 }
@@ -525,19 +635,16 @@ static BSTR find_element_uri(saxlocator *locator, const xmlChar *uri)
 
     if (!uri) return NULL;
 
-    uriW = bstr_from_xmlChar(uri);
+    /* cached names are unique, so comparing pointers is enough */
+    uriW = get_name(locator, NULL, uri);
 
     LIST_FOR_EACH_ENTRY(element, &locator->elements, element_entry, entry)
     {
         for (i=0; i < element->ns_count; i++)
-            if (!wcscmp(uriW, element->ns[i].uri))
-            {
-                SysFreeString(uriW);
-                return element->ns[i].uri;
-            }
+            if (uriW == element->ns[i].uri)
+                return uriW;
     }
 
-    SysFreeString(uriW);
     ERR("namespace uri not found, %s\n", debugstr_a((char*)uri));
     return NULL;
 }
@@ -621,23 +728,6 @@ static BSTR bstr_from_xmlCharN(const xmlChar *buf, int len)
     return bstr;
 }
 
-static BSTR QName_from_xmlChar(const xmlChar *prefix, const xmlChar *name)
-{
-    xmlChar *qname;
-    BSTR bstr;
-
-    if(!name) return NULL;
-
-    if(!prefix || !*prefix)
-        return bstr_from_xmlChar(name);
-
-    qname = xmlBuildQName(name, prefix, NULL, 0);
-    bstr = bstr_from_xmlChar(qname);
-    xmlFree(qname);
-
-    return bstr;
-}
-
 static BSTR pooled_bstr_from_xmlChar(struct bstrpool *pool, const xmlChar *buf)
 {
     BSTR pool_entry = bstr_from_xmlChar(buf);
@@ -1435,15 +1525,14 @@ static void free_attribute_values(saxlocator *locator)
 {
     int i;
 
+    /* names are owned by the locator name cache */
     for (i = 0; i < locator->attr_count; i++)
     {
-        SysFreeString(locator->attributes[i].szLocalname);
         locator->attributes[i].szLocalname = NULL;
 
         SysFreeString(locator->attributes[i].szValue);
         locator->attributes[i].szValue = NULL;
 
-        SysFreeString(locator->attributes[i].szQName);
         locator->attributes[i].szQName = NULL;
     }
 }
@@ -1453,7 +1542,6 @@ static HRESULT SAXAttributes_populate(saxlocator *locator,
         int nb_attributes, const xmlChar **xmlAttributes)
 {
     static const xmlChar xmlns[] = "xmlns";
-    static const WCHAR xmlnsW[] = { 'x','m','l','n','s',0 };
 
     struct _attributes *attrs;
     int i;
@@ -1483,19 +1571,17 @@ static HRESULT SAXAttributes_populate(saxlocator *locator,
 
     for (i = 0; i < nb_namespaces; i++)
     {
-        SysFreeString(attrs[nb_attributes+i].szLocalname);
-        attrs[nb_attributes+i].szLocalname = SysAllocStringLen(NULL, 0);
+        attrs[nb_attributes+i].szLocalname = get_name(locator, NULL, NULL);
 
         attrs[nb_attributes+i].szURI = locator->namespaceUri;
 
         SysFreeString(attrs[nb_attributes+i].szValue);
         attrs[nb_attributes+i].szValue = bstr_from_xmlChar(xmlNamespaces[2*i+1]);
 
-        SysFreeString(attrs[nb_attributes+i].szQName);
         if(!xmlNamespaces[2*i])
-            attrs[nb_attributes+i].szQName = SysAllocString(xmlnsW);
+            attrs[nb_attributes+i].szQName = get_name(locator, NULL, xmlns);
         else
-            attrs[nb_attributes+i].szQName = QName_from_xmlChar(xmlns, xmlNamespaces[2*i]);
+            attrs[nb_attributes+i].szQName = get_name(locator, xmlns, xmlNamespaces[2*i]);
     }
 
     for (i = 0; i < nb_attributes; i++)
@@ -1503,19 +1589,17 @@ static HRESULT SAXAttributes_populate(saxlocator *locator,
         static const xmlChar xmlA[] = "xml";
 
         if (xmlStrEqual(xmlAttributes[i*5+1], xmlA))
-            attrs[i].szURI = bstr_from_xmlChar(xmlAttributes[i*5+2]);
+            attrs[i].szURI = get_name(locator, NULL, xmlAttributes[i*5+2]);
         else
             /* that's an important feature to keep same uri pointer for every reported attribute */
             attrs[i].szURI = find_element_uri(locator, xmlAttributes[i*5+2]);
 
-        SysFreeString(attrs[i].szLocalname);
-        attrs[i].szLocalname = bstr_from_xmlChar(xmlAttributes[i*5]);
+        attrs[i].szLocalname = get_name(locator, NULL, xmlAttributes[i*5]);
 
         SysFreeString(attrs[i].szValue);
         attrs[i].szValue = saxreader_get_unescaped_value(xmlAttributes[i*5+3], xmlAttributes[i*5+4]-xmlAttributes[i*5+3]);
 
-        SysFreeString(attrs[i].szQName);
-        attrs[i].szQName = QName_from_xmlChar(xmlAttributes[i*5+1], xmlAttributes[i*5]);
+        attrs[i].szQName = get_name(locator, xmlAttributes[i*5+1], xmlAttributes[i*5]);
     }
 
     return S_OK;
@@ -1615,7 +1699,7 @@ static void libxmlStartElementNS(
     if(This->saxreader->version < MSXML4)
         This->column++;
 
-    element = alloc_element_entry(localname, prefix, nb_namespaces, namespaces);
+    element = alloc_element_entry(This, localname, prefix, nb_namespaces, namespaces);
     push_element_ns(This, element);
 
     if (is_namespaces_enabled(This->saxreader))
@@ -1625,10 +1709,13 @@ static void libxmlStartElementNS(
         for (i = 0; i < nb_namespaces && saxreader_has_handler(This, SAXContentHandler); i++)
         {
             if (This->vbInterface)
-                hr = IVBSAXContentHandler_startPrefixMapping(
-                        handler->vbhandler,
-                        &element->ns[i].prefix,
-                        &element->ns[i].uri);
+            {
+                BSTR prefix = copy_name(element->ns[i].prefix), uri = copy_name(element->ns[i].uri);
+
+                hr = IVBSAXContentHandler_startPrefixMapping(handler->vbhandler, &prefix, &uri);
+                SysFreeString(prefix);
+                SysFreeString(uri);
+            }
             else
                 hr = ISAXContentHandler_startPrefixMapping(
                         handler->handler,
@@ -1657,8 +1744,17 @@ static void libxmlStartElementNS(
             uri = local = NULL;
 
         if (This->vbInterface)
+        {
+            BSTR qname = copy_name(element->qname);
+
+            uri = copy_name(uri);
+            local = copy_name(local);
             hr = IVBSAXContentHandler_startElement(handler->vbhandler,
-                    &uri, &local, &element->qname, &This->IVBSAXAttributes_iface);
+                    &uri, &local, &qname, &This->IVBSAXAttributes_iface);
+            SysFreeString(uri);
+            SysFreeString(local);
+            SysFreeString(qname);
+        }
         else
             hr = ISAXContentHandler_startElement(handler->handler,
                     uri ? uri : &empty_str, SysStringLen(uri),
@@ -1729,9 +1825,16 @@ static void libxmlEndElementNS(
         uri = local = NULL;
 
     if (This->vbInterface)
-        hr = IVBSAXContentHandler_endElement(
-                handler->vbhandler,
-                &uri, &local, &element->qname);
+    {
+        BSTR qname = copy_name(element->qname);
+
+        uri = copy_name(uri);
+        local = copy_name(local);
+        hr = IVBSAXContentHandler_endElement(handler->vbhandler, &uri, &local, &qname);
+        SysFreeString(uri);
+        SysFreeString(local);
+        SysFreeString(qname);
+    }
     else
         hr = ISAXContentHandler_endElement(
                 handler->handler,
@@ -1755,8 +1858,12 @@ static void libxmlEndElementNS(
         while (iterate_endprefix_index(This, element, &i) && saxreader_has_handler(This, SAXContentHandler))
         {
             if (This->vbInterface)
-                hr = IVBSAXContentHandler_endPrefixMapping(
-                        handler->vbhandler, &element->ns[i].prefix);
+            {
+                BSTR prefix = copy_name(element->ns[i].prefix);
+
+                hr = IVBSAXContentHandler_endPrefixMapping(handler->vbhandler, &prefix);
+                SysFreeString(prefix);
+            }
             else
                 hr = ISAXContentHandler_endPrefixMapping(
                         handler->handler, element->ns[i].prefix, SysStringLen(element->ns[i].prefix));
@@ -2340,11 +2447,7 @@ static ULONG WINAPI isaxlocator_Release(
         SysFreeString(This->namespaceUri);
 
         for(index = 0; index < This->attr_alloc_count; index++)
-        {
-            SysFreeString(This->attributes[index].szLocalname);
             SysFreeString(This->attributes[index].szValue);
-            SysFreeString(This->attributes[index].szQName);
-        }
         heap_free(This->attributes);
 
         /* element stack */
@@ -2353,6 +2456,7 @@ static ULONG WINAPI isaxlocator_Release(
             list_remove(&element->entry);
             free_element_entry(element);
         }
+        free_names(This);
 
         ISAXXMLReader_Release(&This->saxreader->ISAXXMLReader_iface);
         heap_free( This );
@@ -2487,6 +2591,9 @@ static HRESULT SAXLocator_create(saxreader *reader, saxlocator **ppsaxlocator, B
     }
 
     list_init(&locator->elements);
+    locator->names = NULL;
+    locator->names_size = 0;
+    locator->names_count = 0;
 
     *ppsaxlocator = locator;
 
@@ -53,6 +53,29 @@ WINE_DEFAULT_DEBUG_CHANNEL(msxml);
 int registerNamespaces(xmlXPathContextPtr ctxt);
 xmlChar* XSLPattern_to_XPath(xmlXPathContextPtr ctxt, xmlChar const* xslpat_str);
 
+/* Compiled queries are kept with document properties, so running the same query
+ * again skips XSLPattern translation and XPath parsing. Entries are reference counted,
+ * an evicted query stays alive until selections still evaluating it are done. */
+#define MAX_CACHED_QUERIES 32
+
+struct compiled_query
+{
+    struct list entry;
+    LONG refs;
+    BOOL xpath;
+    xmlXPathCompExprPtr comp;
+    xmlChar query[1];
+};
+
+static CRITICAL_SECTION query_cache_cs;
+static CRITICAL_SECTION_DEBUG query_cache_cs_dbg =
+{
+    0, 0, &query_cache_cs,
+    { &query_cache_cs_dbg.ProcessLocksList, &query_cache_cs_dbg.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": query_cache") }
+};
+static CRITICAL_SECTION query_cache_cs = { &query_cache_cs_dbg, -1, 0, 0, 0, 0 };
+
 typedef struct
 {
     IEnumVARIANT IEnumVARIANT_iface;
@@ -761,10 +784,89 @@ static void query_serror(void* ctx, xmlErrorPtr err)
     LIBXML2_CALLBACK_SERROR(domselection_create, err);
 }
 
+static void release_compiled_query(struct compiled_query *query)
+{
+    if (InterlockedDecrement(&query->refs)) return;
+
+    xmlXPathFreeCompExpr(query->comp);
+    heap_free(query);
+}
+
+void clear_query_cache(struct list *cache)
+{
+    struct compiled_query *query, *query2;
+
+    EnterCriticalSection(&query_cache_cs);
+    LIST_FOR_EACH_ENTRY_SAFE(query, query2, cache, struct compiled_query, entry)
+    {
+        list_remove(&query->entry);
+        release_compiled_query(query);
+    }
+    LeaveCriticalSection(&query_cache_cs);
+}
+
+/* context is expected to have selection namespaces registered already */
+static struct compiled_query *get_compiled_query(xmlXPathContextPtr ctxt, const xmlChar *str)
+{
+    struct list *cache = xmldoc_query_cache(ctxt->doc);
+    BOOL xpath = is_xpathmode(ctxt->doc);
+    struct compiled_query *query;
+    xmlXPathCompExprPtr comp;
+    xmlChar *expr = NULL;
+    int len;
+
+    EnterCriticalSection(&query_cache_cs);
+    LIST_FOR_EACH_ENTRY(query, cache, struct compiled_query, entry)
+    {
+        if (query->xpath == xpath && xmlStrEqual(query->query, str))
+        {
+            /* most recently used queries are kept at the head */
+            list_remove(&query->entry);
+            list_add_head(cache, &query->entry);
+            InterlockedIncrement(&query->refs);
+            LeaveCriticalSection(&query_cache_cs);
+            return query;
+        }
+    }
+    LeaveCriticalSection(&query_cache_cs);
+
+    if (!xpath)
+        expr = XSLPattern_to_XPath(ctxt, str);
+    comp = xmlXPathCtxtCompile(ctxt, expr ? expr : str);
+    xmlFree(expr);
+    if (!comp) return NULL;
+
+    len = xmlStrlen(str);
+    if (!(query = heap_alloc(FIELD_OFFSET(struct compiled_query, query[len + 1]))))
+    {
+        xmlXPathFreeCompExpr(comp);
+        return NULL;
+    }
+
+    /* one reference for the cache, one for the caller */
+    query->refs = 2;
+    query->xpath = xpath;
+    query->comp = comp;
+    memcpy(query->query, str, len + 1);
+
+    EnterCriticalSection(&query_cache_cs);
+    list_add_head(cache, &query->entry);
+    if (list_count(cache) > MAX_CACHED_QUERIES)
+    {
+        struct compiled_query *last = LIST_ENTRY(list_tail(cache), struct compiled_query, entry);
+        list_remove(&last->entry);
+        release_compiled_query(last);
+    }
+    LeaveCriticalSection(&query_cache_cs);
+
+    return query;
+}
+
 HRESULT create_selection(xmlNodePtr node, xmlChar* query, IXMLDOMNodeList **out)
 {
     domselection *This = heap_alloc(sizeof(domselection));
     xmlXPathContextPtr ctxt = xmlXPathNewContext(node->doc);
+    struct compiled_query *compiled;
     HRESULT hr;
 
     TRACE("(%p, %s, %p)\n", node, debugstr_a((char const*)query), out);
@@ -792,12 +894,9 @@ HRESULT create_selection(xmlNodePtr node, xmlChar* query, IXMLDOMNodeList **out)
     if (is_xpathmode(This->node->doc))
     {
         xmlXPathRegisterAllFunctions(ctxt);
-        This->result = xmlXPathEvalExpression(query, ctxt);
     }
     else
     {
-        xmlChar* pattern_query = XSLPattern_to_XPath(ctxt, query);
-
         xmlXPathRegisterFunc(ctxt, (xmlChar const*)"not", xmlXPathNotFunction);
         xmlXPathRegisterFunc(ctxt, (xmlChar const*)"boolean", xmlXPathBooleanFunction);
 
@@ -811,10 +910,15 @@ HRESULT create_selection(xmlNodePtr node, xmlChar* query, IXMLDOMNodeList **out)
         xmlXPathRegisterFunc(ctxt, (xmlChar const*)"OP_ILEq", XSLPattern_OP_ILEq);
         xmlXPathRegisterFunc(ctxt, (xmlChar const*)"OP_IGt", XSLPattern_OP_IGt);
         xmlXPathRegisterFunc(ctxt, (xmlChar const*)"OP_IGEq", XSLPattern_OP_IGEq);
+    }
 
-        This->result = xmlXPathEvalExpression(pattern_query, ctxt);
-        xmlFree(pattern_query);
+    if ((compiled = get_compiled_query(ctxt, query)))
+    {
+        This->result = xmlXPathCompiledEval(compiled->comp, ctxt);
+        release_compiled_query(compiled);
     }
+    else
+        This->result = NULL;
 
     if (!This->result || This->result->type != XPATH_NODESET)
     {
@@ -7556,6 +7556,27 @@ static void test_XSLPattern(void)
     ok(len == 0, "expected empty list\n");
     IXMLDOMNodeList_Release(list);
 
+    /* same query string means different things in XPath and XSLPattern modes */
+    for (len = 0; len < 3; len++)
+    {
+        hr = IXMLDOMDocument2_selectNodes(doc, _bstr_("root//elem[end()]"), &list);
+        EXPECT_HR(hr, S_OK);
+        expect_list_and_release(list, "E4.E2.D1");
+    }
+
+    hr = IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionLanguage"), _variantbstr_("XPath"));
+    EXPECT_HR(hr, S_OK);
+
+    hr = IXMLDOMDocument2_selectNodes(doc, _bstr_("root//elem[end()]"), &list);
+    EXPECT_HR(hr, E_FAIL);
+
+    hr = IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionLanguage"), _variantbstr_("XSLPattern"));
+    EXPECT_HR(hr, S_OK);
+
+    hr = IXMLDOMDocument2_selectNodes(doc, _bstr_("root//elem[end()]"), &list);
+    EXPECT_HR(hr, S_OK);
+    expect_list_and_release(list, "E4.E2.D1");
+
     IXMLDOMDocument2_Release(doc);
 
     doc = create_document(&IID_IXMLDOMDocument2);
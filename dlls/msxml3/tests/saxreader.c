@@ -4826,6 +4826,116 @@ static void test_mxwriter_encoding(void)
     free_bstrs();
 }
 
+static void test_mxwriter_large_output(void)
+{
+    static const char expectedA[] = "\xc3\xa9\xf0\x9f\x98\x80&amp;";
+    ISAXContentHandler *content;
+    IMXWriter *writer;
+    LARGE_INTEGER pos;
+    ULARGE_INTEGER pos2;
+    IStream *stream;
+    VARIANT dest;
+    WCHAR *chars;
+    HRESULT hr;
+    HGLOBAL g;
+    char *ptr;
+    int i;
+
+    hr = CoCreateInstance(&CLSID_MXXMLWriter, NULL, CLSCTX_INPROC_SERVER,
+            &IID_IMXWriter, (void**)&writer);
+    EXPECT_HR(hr, S_OK);
+
+    hr = IMXWriter_QueryInterface(writer, &IID_ISAXContentHandler, (void**)&content);
+    EXPECT_HR(hr, S_OK);
+
+    hr = IMXWriter_put_omitXMLDeclaration(writer, VARIANT_TRUE);
+    EXPECT_HR(hr, S_OK);
+
+    chars = heap_alloc(20000 * sizeof(WCHAR));
+
+    /* multibyte output spanning several internal chunks, surrogate pairs must not be split */
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    EXPECT_HR(hr, S_OK);
+
+    hr = IMXWriter_put_encoding(writer, _bstr_("UTF-8"));
+    EXPECT_HR(hr, S_OK);
+
+    V_VT(&dest) = VT_UNKNOWN;
+    V_UNKNOWN(&dest) = (IUnknown*)stream;
+    hr = IMXWriter_put_output(writer, dest);
+    EXPECT_HR(hr, S_OK);
+
+    hr = ISAXContentHandler_startDocument(content);
+    EXPECT_HR(hr, S_OK);
+
+    for (i = 0; i < 3000; i++)
+    {
+        chars[4*i] = 0xe9;
+        chars[4*i+1] = 0xd83d;
+        chars[4*i+2] = 0xde00;
+        chars[4*i+3] = '&';
+    }
+    /* odd sized calls */
+    for (i = 0; i < 12000; i += 7)
+    {
+        hr = ISAXContentHandler_characters(content, chars + i, min(7, 12000 - i));
+        EXPECT_HR(hr, S_OK);
+    }
+
+    hr = ISAXContentHandler_endDocument(content);
+    EXPECT_HR(hr, S_OK);
+
+    pos.QuadPart = 0;
+    hr = IStream_Seek(stream, pos, STREAM_SEEK_CUR, &pos2);
+    EXPECT_HR(hr, S_OK);
+    ok(pos2.QuadPart == 3000 * (sizeof(expectedA) - 1), "got size %s\n", wine_dbgstr_longlong(pos2.QuadPart));
+
+    hr = GetHGlobalFromStream(stream, &g);
+    EXPECT_HR(hr, S_OK);
+
+    ptr = GlobalLock(g);
+    for (i = 0; i < 3000; i++)
+        if (memcmp(ptr + i * (sizeof(expectedA) - 1), expectedA, sizeof(expectedA) - 1)) break;
+    ok(i == 3000, "got wrong content at %d\n", i);
+    GlobalUnlock(g);
+
+    IStream_Release(stream);
+
+    /* BSTR output accumulated over several blocks */
+    V_VT(&dest) = VT_EMPTY;
+    hr = IMXWriter_put_output(writer, dest);
+    EXPECT_HR(hr, S_OK);
+
+    hr = ISAXContentHandler_startDocument(content);
+    EXPECT_HR(hr, S_OK);
+
+    for (i = 0; i < 20000; i++)
+        chars[i] = 'a' + i % 26;
+    for (i = 0; i < 5; i++)
+    {
+        hr = ISAXContentHandler_characters(content, chars, 20000);
+        EXPECT_HR(hr, S_OK);
+    }
+
+    hr = ISAXContentHandler_endDocument(content);
+    EXPECT_HR(hr, S_OK);
+
+    V_VT(&dest) = VT_EMPTY;
+    hr = IMXWriter_get_output(writer, &dest);
+    EXPECT_HR(hr, S_OK);
+    ok(V_VT(&dest) == VT_BSTR, "got %d\n", V_VT(&dest));
+    ok(SysStringLen(V_BSTR(&dest)) == 100000, "got len %d\n", SysStringLen(V_BSTR(&dest)));
+    for (i = 0; i < 5; i++)
+        if (memcmp(V_BSTR(&dest) + i * 20000, chars, 20000 * sizeof(WCHAR))) break;
+    ok(i == 5, "got wrong content in chunk %d\n", i);
+    VariantClear(&dest);
+
+    heap_free(chars);
+    ISAXContentHandler_Release(content);
+    IMXWriter_Release(writer);
+    free_bstrs();
+}
+
 static void test_obj_dispex(IUnknown *obj)
 {
     DISPID dispid = DISPID_SAX_XMLREADER_GETFEATURE;
@@ -6059,6 +6169,7 @@ START_TEST(saxreader)
         test_mxwriter_stream();
         test_mxwriter_domdoc();
         test_mxwriter_encoding();
+        test_mxwriter_large_output();
         test_mxwriter_dispex();
         test_mxwriter_indent();
     }
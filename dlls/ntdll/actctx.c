@@ -33,6 +33,7 @@
 #include "ddk/wdm.h"
 #include "ntdll_misc.h"
 #include "wine/exception.h"
+#include "wine/list.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(actctx);
@@ -547,6 +548,7 @@ typedef struct _ACTIVATION_CONTEXT
     struct guidsection_header *comserver_section;
     struct guidsection_header *ifaceps_section;
     struct guidsection_header *clrsurrogate_section;
+    struct _ACTIVATION_CONTEXT *parsed;  /* context owning the parsed data, for shared handles */
 } ACTIVATION_CONTEXT;
 
 struct actctx_loader
@@ -615,6 +617,71 @@ static const struct olemisc_entry olemisc_values[] =
 static ACTIVATION_CONTEXT system_actctx = { ACTCTX_MAGIC, 1 };
 static ACTIVATION_CONTEXT *process_actctx = &system_actctx;
 
+/* results of winsxs manifest lookups, valid as long as the manifests directory is unchanged */
+struct winsxs_lookup
+{
+    struct list             entry;
+    struct assembly_identity id;       /* identity that was looked up */
+    WCHAR                  *file;      /* manifest file name, NULL if not found */
+    struct assembly_version version;   /* version of the manifest file */
+};
+
+static struct list winsxs_lookups = LIST_INIT( winsxs_lookups );
+static LARGE_INTEGER winsxs_lookups_time;
+
+static RTL_CRITICAL_SECTION winsxs_section;
+static RTL_CRITICAL_SECTION_DEBUG winsxs_section_debug =
+{
+    0, 0, &winsxs_section,
+    { &winsxs_section_debug.ProcessLocksList, &winsxs_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": winsxs_section") }
+};
+static RTL_CRITICAL_SECTION winsxs_section = { &winsxs_section_debug, -1, 0, 0, 0, 0 };
+
+/* parsed activation contexts created from files, reused as long as none of their manifests changed */
+#define ACTCTX_CACHE_SIZE 16
+
+struct actctx_file_stamp
+{
+    LARGE_INTEGER file_id;  /* index number of the file */
+    LARGE_INTEGER size;
+    DWORD         hash;     /* checksum of the file contents */
+};
+
+struct actctx_cache_dependency
+{
+    struct assembly_identity id;    /* identity the dependency was looked up with */
+    WCHAR                   *file;  /* matching winsxs manifest file, if any */
+};
+
+struct actctx_cache_entry
+{
+    struct list                     entry;
+    ACTIVATION_CONTEXT             *actctx;
+    WCHAR                          *source;     /* NT path of the source file */
+    struct actctx_file_stamp        stamp;      /* source file stamp */
+    DWORD                           flags;
+    const WCHAR                    *resource;   /* resource id, or copy of the resource name */
+    ULONG                           lang;
+    WCHAR                          *directory;
+    unsigned int                    num_dependencies;
+    struct actctx_cache_dependency *dependencies;
+    unsigned int                    count;      /* number of assembly manifest stamps */
+    struct actctx_file_stamp        stamps[1];  /* stamps of the assembly manifests */
+};
+
+static struct list actctx_cache = LIST_INIT( actctx_cache );
+static unsigned int actctx_cache_count;
+
+static RTL_CRITICAL_SECTION actctx_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG actctx_cache_section_debug =
+{
+    0, 0, &actctx_cache_section,
+    { &actctx_cache_section_debug.ProcessLocksList, &actctx_cache_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": actctx_cache_section") }
+};
+static RTL_CRITICAL_SECTION actctx_cache_section = { &actctx_cache_section_debug, -1, 0, 0, 0, 0 };
+
 static WCHAR *strdupW(const WCHAR* str)
 {
     WCHAR*      ptr;
@@ -1058,8 +1125,32 @@ static void actctx_release( ACTIVATION_CONTEXT *actctx )
 {
     if (!InterlockedDecrement( &actctx->ref_count ))
     {
+        ACTIVATION_CONTEXT *parsed = actctx->parsed;
         unsigned int i, j;
 
+        if (parsed)
+        {
+            /* only free the sections that were built for this handle */
+            if (actctx->dllredirect_section != parsed->dllredirect_section)
+                RtlFreeHeap( GetProcessHeap(), 0, actctx->dllredirect_section );
+            if (actctx->wndclass_section != parsed->wndclass_section)
+                RtlFreeHeap( GetProcessHeap(), 0, actctx->wndclass_section );
+            if (actctx->tlib_section != parsed->tlib_section)
+                RtlFreeHeap( GetProcessHeap(), 0, actctx->tlib_section );
+            if (actctx->comserver_section != parsed->comserver_section)
+                RtlFreeHeap( GetProcessHeap(), 0, actctx->comserver_section );
+            if (actctx->ifaceps_section != parsed->ifaceps_section)
+                RtlFreeHeap( GetProcessHeap(), 0, actctx->ifaceps_section );
+            if (actctx->clrsurrogate_section != parsed->clrsurrogate_section)
+                RtlFreeHeap( GetProcessHeap(), 0, actctx->clrsurrogate_section );
+            if (actctx->progid_section != parsed->progid_section)
+                RtlFreeHeap( GetProcessHeap(), 0, actctx->progid_section );
+            actctx->magic = 0;
+            RtlFreeHeap( GetProcessHeap(), 0, actctx );
+            actctx_release( parsed );
+            return;
+        }
+
         for (i = 0; i < actctx->num_assemblies; i++)
         {
             struct assembly *assembly = &actctx->assemblies[i];
@@ -3105,50 +3196,144 @@ static WCHAR *lookup_manifest_file( HANDLE dir, struct assembly_identity *ai )
     return ret;
 }
 
-static NTSTATUS lookup_winsxs(struct actctx_loader* acl, struct assembly_identity* ai)
+static BOOL is_same_string( const WCHAR *str1, const WCHAR *str2 )
 {
-    struct assembly_identity    sxs_ai;
-    UNICODE_STRING              path_us;
-    OBJECT_ATTRIBUTES           attr;
-    IO_STATUS_BLOCK             io;
-    WCHAR *path, *file = NULL;
+    if (!str1 || !str2) return str1 == str2;
+    return !wcsicmp( str1, str2 );
+}
+
+static BOOL is_same_lookup( const struct assembly_identity *id1, const struct assembly_identity *id2 )
+{
+    return is_same_string( id1->name, id2->name ) &&
+           is_same_string( id1->arch, id2->arch ) &&
+           is_same_string( id1->public_key, id2->public_key ) &&
+           is_same_string( id1->language, id2->language ) &&
+           !memcmp( &id1->version, &id2->version, sizeof(id1->version) );
+}
+
+static void free_winsxs_lookup( struct winsxs_lookup *lookup )
+{
+    free_assembly_identity( &lookup->id );
+    RtlFreeHeap( GetProcessHeap(), 0, lookup->file );
+    RtlFreeHeap( GetProcessHeap(), 0, lookup );
+}
+
+/* caller must own winsxs_section */
+static void add_winsxs_lookup( const struct assembly_identity *id, const WCHAR *file,
+                               const struct assembly_version *version )
+{
+    struct winsxs_lookup *lookup;
+
+    if (!(lookup = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*lookup) ))) return;
+    lookup->id.version = id->version;
+    if ((id->name && !(lookup->id.name = strdupW( id->name ))) ||
+        (id->arch && !(lookup->id.arch = strdupW( id->arch ))) ||
+        (id->public_key && !(lookup->id.public_key = strdupW( id->public_key ))) ||
+        (id->language && !(lookup->id.language = strdupW( id->language ))) ||
+        (file && !(lookup->file = strdupW( file ))))
+    {
+        free_winsxs_lookup( lookup );
+        return;
+    }
+    lookup->version = *version;
+    list_add_tail( &winsxs_lookups, &lookup->entry );
+}
+
+/* find the manifest file for an assembly in the winsxs manifests directory,
+ * reusing the result of previous lookups while the directory is unchanged */
+static WCHAR *find_winsxs_manifest( OBJECT_ATTRIBUTES *attr, struct assembly_identity *ai )
+{
+    FILE_NETWORK_OPEN_INFORMATION info;
+    struct assembly_identity id = *ai;
+    struct winsxs_lookup *lookup, *next;
+    IO_STATUS_BLOCK io;
+    WCHAR *file = NULL;
     HANDLE handle;
+    BOOL cache = !NtQueryFullAttributesFile( attr, &info );
 
-    if (!ai->arch || !ai->name || !ai->public_key) return STATUS_NO_SUCH_FILE;
+    if (cache)
+    {
+        RtlEnterCriticalSection( &winsxs_section );
+        if (info.LastWriteTime.QuadPart != winsxs_lookups_time.QuadPart)
+        {
+            LIST_FOR_EACH_ENTRY_SAFE( lookup, next, &winsxs_lookups, struct winsxs_lookup, entry )
+            {
+                list_remove( &lookup->entry );
+                free_winsxs_lookup( lookup );
+            }
+            winsxs_lookups_time = info.LastWriteTime;
+        }
+        LIST_FOR_EACH_ENTRY( lookup, &winsxs_lookups, struct winsxs_lookup, entry )
+        {
+            if (!is_same_lookup( &lookup->id, ai )) continue;
+            if (lookup->file && !(file = strdupW( lookup->file ))) break;
+            ai->version = lookup->version;
+            RtlLeaveCriticalSection( &winsxs_section );
+            return file;
+        }
+        RtlLeaveCriticalSection( &winsxs_section );
+    }
+
+    if (!NtOpenFile( &handle, GENERIC_READ | SYNCHRONIZE, attr, &io, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                     FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT ))
+    {
+        file = lookup_manifest_file( handle, ai );
+        NtClose( handle );
+    }
+
+    if (cache)
+    {
+        RtlEnterCriticalSection( &winsxs_section );
+        if (info.LastWriteTime.QuadPart == winsxs_lookups_time.QuadPart)
+            add_winsxs_lookup( &id, file, &ai->version );
+        RtlLeaveCriticalSection( &winsxs_section );
+    }
+    return file;
+}
+
+/* find the winsxs manifest file for an assembly, returning the manifests directory in dir */
+static WCHAR *find_winsxs_file( struct assembly_identity *ai, UNICODE_STRING *dir )
+{
+    OBJECT_ATTRIBUTES attr;
+    WCHAR *path, *file;
+
+    if (!ai->arch || !ai->name || !ai->public_key) return NULL;
 
     if (!(path = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(L"\\winsxs\\manifests") +
                                   wcslen(windows_dir) * sizeof(WCHAR) )))
-        return STATUS_NO_MEMORY;
+        return NULL;
 
     wcscpy( path, windows_dir );
     wcscat( path, L"\\winsxs\\manifests" );
 
-    if (!RtlDosPathNameToNtPathName_U( path, &path_us, NULL, NULL ))
+    if (!RtlDosPathNameToNtPathName_U( path, dir, NULL, NULL ))
     {
         RtlFreeHeap( GetProcessHeap(), 0, path );
-        return STATUS_NO_SUCH_FILE;
+        return NULL;
     }
     RtlFreeHeap( GetProcessHeap(), 0, path );
 
     attr.Length = sizeof(attr);
     attr.RootDirectory = 0;
     attr.Attributes = OBJ_CASE_INSENSITIVE;
-    attr.ObjectName = &path_us;
+    attr.ObjectName = dir;
     attr.SecurityDescriptor = NULL;
     attr.SecurityQualityOfService = NULL;
 
-    if (!NtOpenFile( &handle, GENERIC_READ | SYNCHRONIZE, &attr, &io, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                     FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT ))
-    {
-        sxs_ai = *ai;
-        file = lookup_manifest_file( handle, &sxs_ai );
-        NtClose( handle );
-    }
-    if (!file)
-    {
-        RtlFreeUnicodeString( &path_us );
-        return STATUS_NO_SUCH_FILE;
-    }
+    if (!(file = find_winsxs_manifest( &attr, ai ))) RtlFreeUnicodeString( dir );
+    return file;
+}
+
+static NTSTATUS lookup_winsxs(struct actctx_loader* acl, struct assembly_identity* ai)
+{
+    struct assembly_identity    sxs_ai;
+    UNICODE_STRING              path_us;
+    IO_STATUS_BLOCK             io;
+    WCHAR *path, *file = NULL;
+    HANDLE handle;
+
+    sxs_ai = *ai;
+    if (!(file = find_winsxs_file( &sxs_ai, &path_us ))) return STATUS_NO_SUCH_FILE;
 
     /* append file name to directory path */
     if (!(path = RtlReAllocateHeap( GetProcessHeap(), 0, path_us.Buffer,
@@ -4881,6 +5066,230 @@ static const WCHAR *find_app_settings( ACTIVATION_CONTEXT *actctx, const WCHAR *
     return NULL;
 }
 
+static BOOL get_file_stamp( HANDLE file, struct actctx_file_stamp *stamp )
+{
+    FILE_END_OF_FILE_INFORMATION info;
+    FILE_INTERNAL_INFORMATION internal;
+    OBJECT_ATTRIBUTES attr;
+    IO_STATUS_BLOCK io;
+    LARGE_INTEGER size, offset;
+    HANDLE mapping;
+    SIZE_T count = 0;
+    void *base = NULL;
+
+    if (NtQueryInformationFile( file, &io, &internal, sizeof(internal), FileInternalInformation )) return FALSE;
+    if (NtQueryInformationFile( file, &io, &info, sizeof(info), FileEndOfFileInformation )) return FALSE;
+    stamp->file_id = internal.IndexNumber;
+    stamp->size = info.EndOfFile;
+    stamp->hash = 0;
+    if (!info.EndOfFile.QuadPart) return TRUE;
+    if (info.EndOfFile.QuadPart > MAXLONG) return FALSE;
+
+    InitializeObjectAttributes( &attr, NULL, 0, 0, NULL );
+    size.QuadPart = 0;
+    if (NtCreateSection( &mapping, STANDARD_RIGHTS_REQUIRED | SECTION_QUERY | SECTION_MAP_READ,
+                         &attr, &size, PAGE_READONLY, SEC_COMMIT, file ))
+        return FALSE;
+    offset.QuadPart = 0;
+    if (NtMapViewOfSection( mapping, GetCurrentProcess(), &base, 0, 0, &offset,
+                            &count, ViewShare, 0, PAGE_READONLY ))
+        base = NULL;
+    NtClose( mapping );
+    if (!base) return FALSE;
+
+    stamp->hash = RtlComputeCrc32( 0, base, info.EndOfFile.QuadPart );
+    NtUnmapViewOfSection( GetCurrentProcess(), base );
+    return TRUE;
+}
+
+static BOOL get_manifest_stamp( const struct assembly *assembly, struct actctx_file_stamp *stamp )
+{
+    UNICODE_STRING name;
+    HANDLE file;
+    BOOL ret;
+
+    memset( stamp, 0, sizeof(*stamp) );
+    if (!assembly->manifest.info) return TRUE;
+    if (!RtlDosPathNameToNtPathName_U( assembly->manifest.info, &name, NULL, NULL )) return FALSE;
+    if ((ret = !open_nt_file( &file, &name )))
+    {
+        ret = get_file_stamp( file, stamp );
+        NtClose( file );
+    }
+    RtlFreeUnicodeString( &name );
+    return ret;
+}
+
+static BOOL is_same_stamp( const struct actctx_file_stamp *stamp1, const struct actctx_file_stamp *stamp2 )
+{
+    return stamp1->file_id.QuadPart == stamp2->file_id.QuadPart &&
+           stamp1->size.QuadPart == stamp2->size.QuadPart &&
+           stamp1->hash == stamp2->hash;
+}
+
+static BOOL is_same_resource( const WCHAR *res1, const WCHAR *res2 )
+{
+    if (!((ULONG_PTR)res1 >> 16) || !((ULONG_PTR)res2 >> 16)) return res1 == res2;
+    return !wcsicmp( res1, res2 );
+}
+
+/* check that looking up the dependencies in winsxs still gives the same manifests */
+static BOOL is_same_winsxs_lookup( const struct actctx_cache_entry *cache )
+{
+    struct assembly_identity id;
+    UNICODE_STRING dir;
+    unsigned int i;
+    WCHAR *file;
+    BOOL ret;
+
+    for (i = 0; i < cache->num_dependencies; i++)
+    {
+        id = cache->dependencies[i].id;
+        if ((file = find_winsxs_file( &id, &dir ))) RtlFreeUnicodeString( &dir );
+        ret = is_same_string( file, cache->dependencies[i].file );
+        RtlFreeHeap( GetProcessHeap(), 0, file );
+        if (!ret) return FALSE;
+    }
+    return TRUE;
+}
+
+static void free_actctx_cache_entry( struct actctx_cache_entry *cache )
+{
+    unsigned int i;
+
+    if (cache->actctx) actctx_release( cache->actctx );
+    for (i = 0; i < cache->num_dependencies; i++)
+    {
+        free_assembly_identity( &cache->dependencies[i].id );
+        RtlFreeHeap( GetProcessHeap(), 0, cache->dependencies[i].file );
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, cache->dependencies );
+    if ((ULONG_PTR)cache->resource >> 16) RtlFreeHeap( GetProcessHeap(), 0, (WCHAR *)cache->resource );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->source );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->directory );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+/* create a new handle sharing the parsed data of a cached context */
+static ACTIVATION_CONTEXT *clone_actctx( ACTIVATION_CONTEXT *parsed )
+{
+    ACTIVATION_CONTEXT *actctx;
+
+    if (!(actctx = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*actctx) ))) return NULL;
+    *actctx = *parsed;
+    actctx->ref_count = 1;
+    actctx->parsed = parsed;
+    actctx_addref( parsed );
+    return actctx;
+}
+
+/* find a context built with the same parameters from manifests that are still unchanged */
+static ACTIVATION_CONTEXT *find_cached_actctx( const UNICODE_STRING *source, const struct actctx_file_stamp *file_stamp,
+                                              DWORD flags, const WCHAR *resource, ULONG lang,
+                                              const WCHAR *directory, const WCHAR *appdir )
+{
+    struct actctx_cache_entry *cache;
+    struct actctx_file_stamp stamp;
+    ACTIVATION_CONTEXT *ret = NULL;
+    unsigned int i;
+
+    RtlEnterCriticalSection( &actctx_cache_section );
+    LIST_FOR_EACH_ENTRY( cache, &actctx_cache, struct actctx_cache_entry, entry )
+    {
+        if (wcsicmp( cache->source, source->Buffer ) || cache->flags != flags || cache->lang != lang ||
+            !is_same_resource( cache->resource, resource ) || !is_same_string( cache->directory, directory ) ||
+            !is_same_string( cache->actctx->appdir.info, appdir ))
+            continue;
+
+        if (is_same_stamp( &cache->stamp, file_stamp ) && is_same_winsxs_lookup( cache ))
+        {
+            for (i = 0; i < cache->count; i++)
+            {
+                if (!get_manifest_stamp( &cache->actctx->assemblies[i], &stamp )) break;
+                if (!is_same_stamp( &stamp, &cache->stamps[i] )) break;
+            }
+            if (i == cache->count)
+            {
+                if ((ret = clone_actctx( cache->actctx )))
+                {
+                    list_remove( &cache->entry );
+                    list_add_head( &actctx_cache, &cache->entry );
+                }
+                break;
+            }
+        }
+        TRACE( "dropping outdated context %p for %s\n", cache->actctx, debugstr_w(cache->source) );
+        list_remove( &cache->entry );
+        actctx_cache_count--;
+        free_actctx_cache_entry( cache );
+        break;
+    }
+    RtlLeaveCriticalSection( &actctx_cache_section );
+    return ret;
+}
+
+static BOOL add_cached_actctx( ACTIVATION_CONTEXT *actctx, const struct actctx_loader *acl,
+                               const UNICODE_STRING *source, const struct actctx_file_stamp *file_stamp,
+                               DWORD flags, const WCHAR *resource, ULONG lang, const WCHAR *directory )
+{
+    struct actctx_cache_entry *cache;
+    struct actctx_cache_dependency *dep;
+    struct assembly_identity id;
+    UNICODE_STRING dir;
+    unsigned int i;
+
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                   offsetof( struct actctx_cache_entry, stamps[actctx->num_assemblies] ))))
+        return FALSE;
+
+    for (i = 0; i < actctx->num_assemblies; i++)
+        if (!get_manifest_stamp( &actctx->assemblies[i], &cache->stamps[i] )) goto failed;
+    cache->count = actctx->num_assemblies;
+
+    if (acl->num_dependencies &&
+        !(cache->dependencies = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                                 acl->num_dependencies * sizeof(*cache->dependencies) )))
+        goto failed;
+    for (i = 0; i < acl->num_dependencies; i++)
+    {
+        dep = &cache->dependencies[cache->num_dependencies++];
+        dep->id.version = acl->dependencies[i].version;
+        if ((acl->dependencies[i].name && !(dep->id.name = strdupW( acl->dependencies[i].name ))) ||
+            (acl->dependencies[i].arch && !(dep->id.arch = strdupW( acl->dependencies[i].arch ))) ||
+            (acl->dependencies[i].public_key && !(dep->id.public_key = strdupW( acl->dependencies[i].public_key ))) ||
+            (acl->dependencies[i].language && !(dep->id.language = strdupW( acl->dependencies[i].language ))))
+            goto failed;
+        id = acl->dependencies[i];
+        if ((dep->file = find_winsxs_file( &id, &dir ))) RtlFreeUnicodeString( &dir );
+    }
+
+    if (!(cache->source = strdupW( source->Buffer ))) goto failed;
+    if (directory && !(cache->directory = strdupW( directory ))) goto failed;
+    if (!((ULONG_PTR)resource >> 16)) cache->resource = resource;
+    else if (!(cache->resource = strdupW( resource ))) goto failed;
+    cache->stamp = *file_stamp;
+    cache->flags = flags;
+    cache->lang = lang;
+    cache->actctx = actctx;
+    actctx_addref( actctx );
+
+    RtlEnterCriticalSection( &actctx_cache_section );
+    list_add_head( &actctx_cache, &cache->entry );
+    if (++actctx_cache_count > ACTCTX_CACHE_SIZE)
+    {
+        cache = LIST_ENTRY( list_tail( &actctx_cache ), struct actctx_cache_entry, entry );
+        list_remove( &cache->entry );
+        actctx_cache_count--;
+        free_actctx_cache_entry( cache );
+    }
+    RtlLeaveCriticalSection( &actctx_cache_section );
+    return TRUE;
+
+failed:
+    free_actctx_cache_entry( cache );
+    return FALSE;
+}
+
 /* initialize the activation context for the current process */
 void actctx_init(void)
 {
@@ -4909,8 +5318,10 @@ void actctx_init(void)
 NTSTATUS WINAPI RtlCreateActivationContext( HANDLE *handle, const void *ptr )
 {
     const ACTCTXW *pActCtx = ptr;  /* FIXME: not the right structure */
-    const WCHAR *directory = NULL;
-    ACTIVATION_CONTEXT *actctx;
+    const WCHAR *directory = NULL, *resource = NULL;
+    ACTIVATION_CONTEXT *actctx, *cached;
+    struct actctx_file_stamp stamp;
+    BOOL cache = FALSE;
     UNICODE_STRING nameW;
     ULONG lang = 0;
     NTSTATUS status = STATUS_NO_MEMORY;
@@ -4998,6 +5409,20 @@ NTSTATUS WINAPI RtlCreateActivationContext( HANDLE *handle, const void *ptr )
 
     if (pActCtx->dwFlags & ACTCTX_FLAG_LANGID_VALID) lang = pActCtx->wLangId;
     if (pActCtx->dwFlags & ACTCTX_FLAG_ASSEMBLY_DIRECTORY_VALID) directory = pActCtx->lpAssemblyDirectory;
+    if (pActCtx->dwFlags & ACTCTX_FLAG_RESOURCE_NAME_VALID) resource = pActCtx->lpResourceName;
+
+    /* the parsed data of contexts loaded from files can be shared, it is not modified once created */
+    if (file && (cache = get_file_stamp( file, &stamp )) &&
+        (cached = find_cached_actctx( &nameW, &stamp, pActCtx->dwFlags, resource, lang,
+                                      directory, actctx->appdir.info )))
+    {
+        TRACE( "reusing context %p for %s\n", cached, debugstr_w(nameW.Buffer) );
+        NtClose( file );
+        RtlFreeUnicodeString( &nameW );
+        actctx_release( actctx );
+        *handle = cached;
+        return STATUS_SUCCESS;
+    }
 
     if (pActCtx->dwFlags & ACTCTX_FLAG_RESOURCE_NAME_VALID)
     {
@@ -5026,10 +5451,19 @@ NTSTATUS WINAPI RtlCreateActivationContext( HANDLE *handle, const void *ptr )
     }
 
     if (file) NtClose( file );
-    RtlFreeUnicodeString( &nameW );
 
     if (status == STATUS_SUCCESS) status = parse_depend_manifests(&acl);
+
+    /* the cache keeps the parsed context, callers always get their own handle */
+    if (status == STATUS_SUCCESS && cache &&
+        add_cached_actctx( actctx, &acl, &nameW, &stamp, pActCtx->dwFlags, resource, lang, directory ) &&
+        (cached = clone_actctx( actctx )))
+    {
+        actctx_release( actctx );
+        actctx = cached;
+    }
     free_depend_manifests( &acl );
+    RtlFreeUnicodeString( &nameW );
 
     if (status == STATUS_SUCCESS) *handle = actctx;
     else actctx_release( actctx );
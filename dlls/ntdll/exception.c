@@ -23,6 +23,7 @@
 #include <errno.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdlib.h>
 
 #define NONAMELESSUNION
 #define NONAMELESSSTRUCT
@@ -286,6 +287,7 @@ LONG WINAPI call_unhandled_exception_filter( PEXCEPTION_POINTERS eptr )
 struct dynamic_unwind_entry
 {
     struct list       entry;
+    unsigned int      order;     /* position in dynamic_unwind_list when the index was built */
     ULONG_PTR         base;
     ULONG_PTR         end;
     RUNTIME_FUNCTION *table;
@@ -306,6 +308,13 @@ static RTL_CRITICAL_SECTION_DEBUG dynamic_unwind_debug =
 };
 static RTL_CRITICAL_SECTION dynamic_unwind_section = { &dynamic_unwind_debug, -1, 0, 0, 0, 0 };
 
+/* dynamic_unwind_list entries sorted by base address, rebuilt on demand after changes */
+static struct dynamic_unwind_entry **dynamic_unwind_index;
+static ULONG_PTR *dynamic_unwind_max_end;  /* highest end address of index entries up to i */
+static unsigned int dynamic_unwind_index_count;
+static unsigned int dynamic_unwind_index_size;
+static BOOL dynamic_unwind_index_valid;
+
 static ULONG_PTR get_runtime_function_end( RUNTIME_FUNCTION *func, ULONG_PTR addr )
 {
 #ifdef __x86_64__
@@ -369,6 +378,7 @@ BOOLEAN CDECL RtlAddFunctionTable( RUNTIME_FUNCTION *table, DWORD count, ULONG_P
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
     list_add_tail( &dynamic_unwind_list, &entry->entry );
+    dynamic_unwind_index_valid = FALSE;
     RtlLeaveCriticalSection( &dynamic_unwind_section );
     return TRUE;
 }
@@ -405,6 +415,7 @@ BOOLEAN CDECL RtlInstallFunctionTableCallback( ULONG_PTR table, ULONG_PTR base,
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
     list_add_tail( &dynamic_unwind_list, &entry->entry );
+    dynamic_unwind_index_valid = FALSE;
     RtlLeaveCriticalSection( &dynamic_unwind_section );
 
     return TRUE;
@@ -435,6 +446,7 @@ DWORD WINAPI RtlAddGrowableFunctionTable( void **table, RUNTIME_FUNCTION *functi
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
     list_add_tail( &dynamic_unwind_list, &entry->entry );
+    dynamic_unwind_index_valid = FALSE;
     RtlLeaveCriticalSection( &dynamic_unwind_section );
 
     *table = entry;
@@ -482,6 +494,7 @@ void WINAPI RtlDeleteGrowableFunctionTable( void *table )
         {
             to_free = entry;
             list_remove( &entry->entry );
+            dynamic_unwind_index_valid = FALSE;
             break;
         }
     }
@@ -507,6 +520,7 @@ BOOLEAN CDECL RtlDeleteFunctionTable( RUNTIME_FUNCTION *table )
         {
             to_free = entry;
             list_remove( &entry->entry );
+            dynamic_unwind_index_valid = FALSE;
             break;
         }
     }
@@ -519,6 +533,135 @@ BOOLEAN CDECL RtlDeleteFunctionTable( RUNTIME_FUNCTION *table )
 }
 
 
+static int __cdecl compare_dynamic_unwind_entries( const void *a, const void *b )
+{
+    const struct dynamic_unwind_entry *entry1 = *(const struct dynamic_unwind_entry * const *)a;
+    const struct dynamic_unwind_entry *entry2 = *(const struct dynamic_unwind_entry * const *)b;
+
+    if (entry1->base != entry2->base) return entry1->base < entry2->base ? -1 : 1;
+    return entry1->order < entry2->order ? -1 : 1;
+}
+
+/* rebuild the sorted index of dynamic function tables; caller must own dynamic_unwind_section */
+static BOOL build_dynamic_unwind_index(void)
+{
+    struct dynamic_unwind_entry *entry;
+    unsigned int i, count = list_count( &dynamic_unwind_list );
+
+    if (count > dynamic_unwind_index_size)
+    {
+        unsigned int size = max( count, 2 * dynamic_unwind_index_size );
+        struct dynamic_unwind_entry **index;
+        ULONG_PTR *max_end;
+
+        if (!(index = RtlAllocateHeap( GetProcessHeap(), 0, size * sizeof(*index) ))) return FALSE;
+        if (!(max_end = RtlAllocateHeap( GetProcessHeap(), 0, size * sizeof(*max_end) )))
+        {
+            RtlFreeHeap( GetProcessHeap(), 0, index );
+            return FALSE;
+        }
+        RtlFreeHeap( GetProcessHeap(), 0, dynamic_unwind_index );
+        RtlFreeHeap( GetProcessHeap(), 0, dynamic_unwind_max_end );
+        dynamic_unwind_index = index;
+        dynamic_unwind_max_end = max_end;
+        dynamic_unwind_index_size = size;
+    }
+
+    i = 0;
+    LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
+    {
+        entry->order = i;
+        dynamic_unwind_index[i++] = entry;
+    }
+    qsort( dynamic_unwind_index, count, sizeof(*dynamic_unwind_index), compare_dynamic_unwind_entries );
+    for (i = 0; i < count; i++)
+        dynamic_unwind_max_end[i] = max( dynamic_unwind_index[i]->end, i ? dynamic_unwind_max_end[i - 1] : 0 );
+
+    dynamic_unwind_index_count = count;
+    dynamic_unwind_index_valid = TRUE;
+    return TRUE;
+}
+
+/* find the first registered dynamic function table containing pc; caller must own dynamic_unwind_section */
+static struct dynamic_unwind_entry *find_dynamic_unwind_entry( ULONG_PTR pc )
+{
+    struct dynamic_unwind_entry *entry, *found = NULL;
+    int min = 0, max, pos = -1;
+
+    if (!dynamic_unwind_index_valid && !build_dynamic_unwind_index())
+    {
+        LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
+            if (pc >= entry->base && pc < entry->end) return entry;
+        return NULL;
+    }
+
+    max = dynamic_unwind_index_count - 1;
+    while (min <= max)
+    {
+        int mid = (min + max) / 2;
+        if (dynamic_unwind_index[mid]->base <= pc)
+        {
+            pos = mid;
+            min = mid + 1;
+        }
+        else max = mid - 1;
+    }
+
+    /* ranges may overlap, the table registered first wins */
+    for (; pos >= 0 && dynamic_unwind_max_end[pos] > pc; pos--)
+    {
+        entry = dynamic_unwind_index[pos];
+        if (pc < entry->end && (!found || entry->order < found->order)) found = entry;
+    }
+    return found;
+}
+
+static inline ULONG_PTR get_runtime_function_begin( RUNTIME_FUNCTION *func )
+{
+#ifdef __arm__
+    return func->BeginAddress & ~1;
+#else
+    return func->BeginAddress;
+#endif
+}
+
+/* look for a function entry cached in the unwind history table of the current stack walk */
+static RUNTIME_FUNCTION *find_history_table_entry( UNWIND_HISTORY_TABLE *table, ULONG_PTR pc, ULONG_PTR *base )
+{
+    ULONG i;
+
+    if (!table || !table->Count || table->Count > UNWIND_HISTORY_TABLE_SIZE) return NULL;
+    if (pc < table->LowAddress || pc >= table->HighAddress) return NULL;
+
+    for (i = 0; i < table->Count; i++)
+    {
+        ULONG_PTR image_base = table->Entry[i].ImageBase;
+        RUNTIME_FUNCTION *func = table->Entry[i].FunctionEntry;
+
+        if (pc >= image_base + get_runtime_function_begin( func ) &&
+            pc < image_base + get_runtime_function_end( func, image_base ))
+        {
+            *base = image_base;
+            return func;
+        }
+    }
+    return NULL;
+}
+
+static void add_history_table_entry( UNWIND_HISTORY_TABLE *table, ULONG_PTR base, RUNTIME_FUNCTION *func )
+{
+    ULONG_PTR start = base + get_runtime_function_begin( func );
+    ULONG_PTR end = base + get_runtime_function_end( func, base );
+
+    if (!table || table->Count >= UNWIND_HISTORY_TABLE_SIZE) return;
+
+    if (!table->Count || start < table->LowAddress) table->LowAddress = start;
+    if (!table->Count || end > table->HighAddress) table->HighAddress = end;
+    table->Entry[table->Count].ImageBase = base;
+    table->Entry[table->Count].FunctionEntry = func;
+    table->Count++;
+}
+
 /* helper for lookup_function_info() */
 static RUNTIME_FUNCTION *find_function_info( ULONG_PTR pc, ULONG_PTR base,
                                              RUNTIME_FUNCTION *func, ULONG size )
@@ -557,12 +700,20 @@ static RUNTIME_FUNCTION *find_function_info( ULONG_PTR pc, ULONG_PTR base,
 /**********************************************************************
  *           lookup_function_info
  */
-RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_TABLE_ENTRY **module )
+RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_TABLE_ENTRY **module,
+                                        UNWIND_HISTORY_TABLE *table )
 {
     RUNTIME_FUNCTION *func = NULL;
     struct dynamic_unwind_entry *entry;
     ULONG size;
 
+    /* module is only needed by the callers when no function entry is found */
+    if ((func = find_history_table_entry( table, pc, base )))
+    {
+        *module = NULL;
+        return func;
+    }
+
     /* PE module or wine module */
     if (!LdrFindEntryForAddress( (void *)pc, module ))
     {
@@ -572,6 +723,7 @@ RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_
         {
             /* lookup in function table */
             func = find_function_info( pc, (ULONG_PTR)(*module)->DllBase, func, size/sizeof(*func) );
+            if (func) add_history_table_entry( table, *base, func );
         }
     }
     else
@@ -579,18 +731,14 @@ RUNTIME_FUNCTION *lookup_function_info( ULONG_PTR pc, ULONG_PTR *base, LDR_DATA_
         *module = NULL;
 
         RtlEnterCriticalSection( &dynamic_unwind_section );
-        LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
+        if ((entry = find_dynamic_unwind_entry( pc )))
         {
-            if (pc >= entry->base && pc < entry->end)
-            {
-                *base = entry->base;
-                /* use callback or lookup in function table */
-                if (entry->callback)
-                    func = entry->callback( pc, entry->context );
-                else
-                    func = find_function_info( pc, entry->base, entry->table, entry->count );
-                break;
-            }
+            *base = entry->base;
+            /* use callback or lookup in function table */
+            if (entry->callback)
+                func = entry->callback( pc, entry->context );
+            else
+                func = find_function_info( pc, entry->base, entry->table, entry->count );
         }
         RtlLeaveCriticalSection( &dynamic_unwind_section );
     }
@@ -607,9 +755,7 @@ PRUNTIME_FUNCTION WINAPI RtlLookupFunctionEntry( ULONG_PTR pc, ULONG_PTR *base,
     LDR_DATA_TABLE_ENTRY *module;
     RUNTIME_FUNCTION *func;
 
-    /* FIXME: should use the history table to make things faster */
-
-    if (!(func = lookup_function_info( pc, base, &module )))
+    if (!(func = lookup_function_info( pc, base, &module, table )))
     {
         *base = 0;
         WARN( "no exception table found for %lx\n", pc );
@@ -1244,6 +1244,23 @@ found:
 }
 
 
+/* length of the run of 7-bit ASCII chars at the start of a UTF-8 string, checked a word at a time */
+static inline unsigned int get_utf8_ascii_run( const char *src, unsigned int len )
+{
+    unsigned int pos = 0;
+    UINT64 val;
+
+    while (pos + sizeof(val) <= len)
+    {
+        memcpy( &val, src + pos, sizeof(val) );
+        if (val & 0x8080808080808080ull) break;
+        pos += sizeof(val);
+    }
+    while (pos < len && (unsigned char)src[pos] < 0x80) pos++;
+    return pos;
+}
+
+
 /* helper for the various utf8 mbstowcs functions */
 static unsigned int decode_utf8_char( unsigned char ch, const char **str, const char *strend )
 {
@@ -1302,7 +1319,7 @@ static unsigned int decode_utf8_char( unsigned char ch, const char **str, const
  */
 NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, const char *src, DWORD srclen )
 {
-    unsigned int res, len;
+    unsigned int i, res, len;
     NTSTATUS status = STATUS_SUCCESS;
     const char *srcend = src + srclen;
     WCHAR *dstend;
@@ -1317,7 +1334,13 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         for (len = 0; src < srcend; len++)
         {
             unsigned char ch = *src++;
-            if (ch < 0x80) continue;
+            if (ch < 0x80)
+            {
+                res = get_utf8_ascii_run( src, srcend - src );
+                src += res;
+                len += res;
+                continue;
+            }
             if ((res = decode_utf8_char( ch, &src, srcend )) > 0x10ffff)
                 status = STATUS_SOME_NOT_MAPPED;
             else
@@ -1333,6 +1356,10 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
             *dst++ = ch;
+            len = get_utf8_ascii_run( src, min( srcend - src, dstend - dst ));
+            for (i = 0; i < len; i++) dst[i] = (unsigned char)src[i];
+            src += len;
+            dst += len;
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
@@ -1358,13 +1385,30 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
 }
 
 
+/* length of the run of 7-bit ASCII chars at the start of a UTF-16 string, checked a word at a time */
+static inline unsigned int get_utf16_ascii_run( const WCHAR *src, unsigned int len )
+{
+    unsigned int pos = 0;
+    UINT64 val;
+
+    while (pos + sizeof(val) / sizeof(WCHAR) <= len)
+    {
+        memcpy( &val, src + pos, sizeof(val) );
+        if (val & 0xff80ff80ff80ff80ull) break;
+        pos += sizeof(val) / sizeof(WCHAR);
+    }
+    while (pos < len && src[pos] < 0x80) pos++;
+    return pos;
+}
+
+
 /**************************************************************************
  *	RtlUnicodeToUTF8N   (NTDLL.@)
  */
 NTSTATUS WINAPI RtlUnicodeToUTF8N( char *dst, DWORD dstlen, DWORD *reslen, const WCHAR *src, DWORD srclen )
 {
     char *end;
-    unsigned int val, len;
+    unsigned int i, val, len;
     NTSTATUS status = STATUS_SUCCESS;
 
     if (!src) return STATUS_INVALID_PARAMETER_4;
@@ -1377,7 +1421,13 @@ NTSTATUS WINAPI RtlUnicodeToUTF8N( char *dst, DWORD dstlen, DWORD *reslen, const
     {
         for (len = 0; srclen; srclen--, src++)
         {
-            if (*src < 0x80) len++;  /* 0x00-0x7f: 1 byte */
+            if (*src < 0x80)  /* 0x00-0x7f: 1 byte */
+            {
+                val = get_utf16_ascii_run( src + 1, srclen - 1 );
+                src += val;
+                srclen -= val;
+                len += val + 1;
+            }
             else if (*src < 0x800) len += 2;  /* 0x80-0x7ff: 2 bytes */
             else
             {
@@ -1407,6 +1457,11 @@ NTSTATUS WINAPI RtlUnicodeToUTF8N( char *dst, DWORD dstlen, DWORD *reslen, const
         {
             if (dst > end - 1) break;
             *dst++ = ch;
+            len = get_utf16_ascii_run( src + 1, min( srclen - 1, end - dst ));
+            for (i = 0; i < len; i++) dst[i] = src[i + 1];
+            src += len;
+            srclen -= len;
+            dst += len;
             continue;
         }
         if (ch < 0x800)  /* 0x80-0x7ff: 2 bytes */
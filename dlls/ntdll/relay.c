@@ -67,6 +67,7 @@ struct relay_private_data
 {
     HMODULE                  module;            /* module handle of this dll */
     unsigned int             base;              /* ordinal base */
+    unsigned int             log_id;            /* module id in the binary relay log */
     char                     dllname[40];       /* dll name (without .dll extension) */
     struct relay_entry_point entry_points[1];   /* list of dll entry points */
 };
@@ -157,6 +158,420 @@ static const WCHAR **load_list( HKEY hkey, const WCHAR *value )
     return list;
 }
 
+/* binary relay log */
+
+#define RELAY_LOG_MAGIC       0x474f4c52  /* "RLOG" */
+#define RELAY_LOG_VERSION     1
+#define RELAY_LOG_MAX_ARGS    8
+#define RELAY_LOG_RING_SIZE   4096  /* records per thread, must be a power of 2 */
+#define RELAY_LOG_MAX_THREADS 256
+
+enum relay_log_chunk_type
+{
+    RELAY_LOG_CHUNK_MODULE = 1,   /* module and function names */
+    RELAY_LOG_CHUNK_RECORDS,      /* array of struct relay_log_record */
+    RELAY_LOG_CHUNK_CLOCK         /* struct relay_log_clock */
+};
+
+struct relay_log_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD pid;
+    DWORD ptr_size;
+};
+
+struct relay_log_chunk
+{
+    DWORD type;
+    DWORD size;
+};
+
+struct relay_log_clock
+{
+    ULONG64 time;        /* timestamp in record units */
+    ULONG64 counter;     /* matching performance counter */
+    ULONG64 frequency;   /* performance counter frequency */
+};
+
+struct relay_log_record
+{
+    ULONG64 time;
+    DWORD   tid;
+    WORD    module;      /* module id from the module chunk */
+    WORD    ordinal;     /* export index, without the ordinal base */
+    BYTE    type;        /* RELAY_LOG_CALL or RELAY_LOG_RET */
+    BYTE    nb_args;     /* number of argument slots, can exceed RELAY_LOG_MAX_ARGS */
+    WORD    reserved1;
+    DWORD   reserved2;
+    ULONG64 retaddr;
+    ULONG64 args[RELAY_LOG_MAX_ARGS];  /* arguments, or return value in args[0] */
+};
+
+#define RELAY_LOG_CALL 0
+#define RELAY_LOG_RET  1
+
+/* per-thread ring buffer; only the owner thread writes records and updates head,
+ * the tail is only updated with relay_log_section held */
+struct relay_log_buffer
+{
+    LONG                     tid;      /* owner thread, 0 if free */
+    LONGLONG                 created;  /* creation time of the owner, tells threads with a reused id apart */
+    BOOL                     detached; /* owner thread is exiting, don't log anything more */
+    volatile ULONG           head;     /* next record to write */
+    volatile ULONG           tail;     /* next record to flush */
+    struct relay_log_record *records;
+};
+
+static HANDLE relay_log_file;
+static LONG relay_log_module_count;
+static LONG relay_log_thread_started;
+static struct relay_log_buffer relay_log_buffers[RELAY_LOG_MAX_THREADS];
+
+static RTL_CRITICAL_SECTION relay_log_section;
+static RTL_CRITICAL_SECTION_DEBUG relay_log_critsect_debug =
+{
+    0, 0, &relay_log_section,
+    { &relay_log_critsect_debug.ProcessLocksList, &relay_log_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": relay_log_section") }
+};
+static RTL_CRITICAL_SECTION relay_log_section = { &relay_log_critsect_debug, -1, 0, 0, 0, 0 };
+
+static inline ULONG64 get_relay_log_time(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    ULONG low, high;
+
+    __asm__ __volatile__( "rdtsc" : "=a" (low), "=d" (high) );
+    return ((ULONG64)high << 32) | low;
+#else
+    LARGE_INTEGER counter;
+
+    NtQueryPerformanceCounter( &counter, NULL );
+    return counter.QuadPart;
+#endif
+}
+
+static void write_relay_log( DWORD type, const void *data, ULONG size )
+{
+    struct relay_log_chunk chunk;
+    IO_STATUS_BLOCK io;
+
+    chunk.type = type;
+    chunk.size = size;
+    NtWriteFile( relay_log_file, 0, NULL, NULL, &io, &chunk, sizeof(chunk), NULL, NULL );
+    NtWriteFile( relay_log_file, 0, NULL, NULL, &io, data, size, NULL, NULL );
+}
+
+/* write a clock chunk, used by the decoder to convert timestamps to seconds */
+static void write_relay_log_clock(void)
+{
+    struct relay_log_clock clock;
+    LARGE_INTEGER counter, frequency;
+
+    clock.time = get_relay_log_time();
+    NtQueryPerformanceCounter( &counter, &frequency );
+    clock.counter = counter.QuadPart;
+    clock.frequency = frequency.QuadPart;
+    write_relay_log( RELAY_LOG_CHUNK_CLOCK, &clock, sizeof(clock) );
+}
+
+/* write the names of a module and of its entry points, so that the records don't need to contain them */
+static void write_relay_log_module( const struct relay_private_data *data, unsigned int count )
+{
+    unsigned int i, size = 3 * sizeof(DWORD) + sizeof(data->dllname);
+    DWORD *header;
+    char *p;
+
+    for (i = 0; i < count; i++)
+        size += (data->entry_points[i].name ? strlen( data->entry_points[i].name ) : 0) + 1;
+
+    if (!(header = RtlAllocateHeap( GetProcessHeap(), 0, size ))) return;
+    header[0] = data->log_id;
+    header[1] = data->base;
+    header[2] = count;
+    p = (char *)(header + 3);
+    memcpy( p, data->dllname, sizeof(data->dllname) );
+    p += sizeof(data->dllname);
+    for (i = 0; i < count; i++)
+    {
+        const char *name = data->entry_points[i].name ? data->entry_points[i].name : "";
+        strcpy( p, name );
+        p += strlen( name ) + 1;
+    }
+
+    RtlEnterCriticalSection( &relay_log_section );
+    write_relay_log( RELAY_LOG_CHUNK_MODULE, header, size );
+    RtlLeaveCriticalSection( &relay_log_section );
+    RtlFreeHeap( GetProcessHeap(), 0, header );
+}
+
+/* flush the pending records of a thread buffer; relay_log_section must be held */
+static void flush_relay_log_buffer( struct relay_log_buffer *buffer )
+{
+    ULONG head = buffer->head, tail = buffer->tail, pos, count;
+
+    MemoryBarrier();
+    while (tail != head)
+    {
+        pos = tail % RELAY_LOG_RING_SIZE;
+        count = min( head - tail, RELAY_LOG_RING_SIZE - pos );
+        write_relay_log( RELAY_LOG_CHUNK_RECORDS, buffer->records + pos, count * sizeof(*buffer->records) );
+        tail += count;
+    }
+    MemoryBarrier();
+    buffer->tail = tail;
+}
+
+static void flush_relay_log(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < RELAY_LOG_MAX_THREADS; i++)
+    {
+        if (!relay_log_buffers[i].tid) continue;
+        if (relay_log_buffers[i].head == relay_log_buffers[i].tail) continue;
+        flush_relay_log_buffer( &relay_log_buffers[i] );
+    }
+    write_relay_log_clock();
+}
+
+static BOOL is_thread_running( LONG tid )
+{
+    THREAD_BASIC_INFORMATION info;
+    OBJECT_ATTRIBUTES attr;
+    CLIENT_ID cid;
+    HANDLE handle;
+    BOOL ret;
+
+    cid.UniqueProcess = 0;
+    cid.UniqueThread = ULongToHandle( tid );
+    InitializeObjectAttributes( &attr, NULL, 0, 0, NULL );
+    if (NtOpenThread( &handle, THREAD_QUERY_LIMITED_INFORMATION, &attr, &cid )) return FALSE;
+    ret = !NtQueryInformationThread( handle, ThreadBasicInformation, &info, sizeof(info), NULL ) &&
+          info.ExitStatus == STATUS_PENDING;
+    NtClose( handle );
+    return ret;
+}
+
+/* release the buffers of threads that are gone, including those that were
+ * terminated without going through RELAY_ThreadDetach; relay_log_section must be held */
+static void reclaim_relay_log_buffers(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < RELAY_LOG_MAX_THREADS; i++)
+    {
+        if (!relay_log_buffers[i].tid || is_thread_running( relay_log_buffers[i].tid )) continue;
+        flush_relay_log_buffer( &relay_log_buffers[i] );
+        relay_log_buffers[i].detached = FALSE;
+        InterlockedExchange( &relay_log_buffers[i].tid, 0 );
+    }
+}
+
+static void WINAPI relay_log_thread( void *arg )
+{
+    LARGE_INTEGER timeout;
+    unsigned int count = 0;
+
+    timeout.QuadPart = -100 * 10000;  /* 100 ms */
+    for (;;)
+    {
+        NtDelayExecution( FALSE, &timeout );
+        RtlEnterCriticalSection( &relay_log_section );
+        flush_relay_log();
+        if (!(++count % 10)) reclaim_relay_log_buffers();
+        RtlLeaveCriticalSection( &relay_log_section );
+    }
+}
+
+static void start_relay_log_thread(void)
+{
+    HANDLE thread;
+
+    if (InterlockedCompareExchange( &relay_log_thread_started, 1, 0 )) return;
+    if (!RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0, 0, 0, relay_log_thread, NULL, &thread, NULL ))
+        NtClose( thread );
+    else
+        ERR( "failed to start relay log thread\n" );
+}
+
+static LONGLONG get_thread_creation_time(void)
+{
+    KERNEL_USER_TIMES times;
+
+    if (NtQueryInformationThread( GetCurrentThread(), ThreadTimes, &times, sizeof(times), NULL )) return 0;
+    return times.CreateTime.QuadPart;
+}
+
+/* find or allocate the ring buffer of the current thread */
+static struct relay_log_buffer *get_relay_log_buffer(void)
+{
+    LONG tid = HandleToLong( NtCurrentTeb()->ClientId.UniqueThread );
+    unsigned int i, start = (tid >> 2) % RELAY_LOG_MAX_THREADS;
+    struct relay_log_buffer *buffer;
+    LONGLONG created;
+    SIZE_T size;
+
+    for (i = 0; i < RELAY_LOG_MAX_THREADS; i++)
+    {
+        buffer = &relay_log_buffers[(start + i) % RELAY_LOG_MAX_THREADS];
+        if (buffer->tid != tid) continue;
+        if (!buffer->detached) return buffer;
+
+        /* the id of an exited thread can be reused before the writer thread
+         * reclaims its buffer, take it over if we are not that thread */
+        created = get_thread_creation_time();
+        if (created == buffer->created) return NULL;
+        RtlEnterCriticalSection( &relay_log_section );
+        if (buffer->tid == tid)  /* not reclaimed meanwhile */
+        {
+            flush_relay_log_buffer( buffer );
+            buffer->created = created;
+            buffer->detached = FALSE;
+        }
+        else buffer = NULL;
+        RtlLeaveCriticalSection( &relay_log_section );
+        if (buffer) return buffer;
+        break;
+    }
+    for (i = 0; i < RELAY_LOG_MAX_THREADS; i++)
+    {
+        buffer = &relay_log_buffers[(start + i) % RELAY_LOG_MAX_THREADS];
+        if (buffer->tid || InterlockedCompareExchange( &buffer->tid, tid, 0 )) continue;
+        if (!buffer->records)
+        {
+            void *ptr = NULL;
+
+            size = RELAY_LOG_RING_SIZE * sizeof(*buffer->records);
+            if (NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 0, &size, MEM_COMMIT, PAGE_READWRITE ))
+            {
+                buffer->tid = 0;
+                return NULL;
+            }
+            buffer->records = ptr;
+        }
+        buffer->created = get_thread_creation_time();
+        start_relay_log_thread();
+        return buffer;
+    }
+    return NULL;  /* too many threads, the calls are not logged */
+}
+
+static struct relay_log_record *alloc_relay_log_record( struct relay_log_buffer *buffer )
+{
+    if (buffer->head - buffer->tail >= RELAY_LOG_RING_SIZE)
+    {
+        /* the writer thread is lagging behind, flush our own buffer */
+        RtlEnterCriticalSection( &relay_log_section );
+        flush_relay_log_buffer( buffer );
+        RtlLeaveCriticalSection( &relay_log_section );
+    }
+    return buffer->records + buffer->head % RELAY_LOG_RING_SIZE;
+}
+
+static inline void commit_relay_log_record( struct relay_log_buffer *buffer )
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__( "" ::: "memory" );  /* stores are not reordered on x86 */
+#else
+    MemoryBarrier();
+#endif
+    buffer->head++;
+}
+
+static void log_relay_call( const struct relay_private_data *data, WORD ordinal,
+                            const ULONG_PTR *stack, unsigned int nb_args, ULONG_PTR retaddr )
+{
+    struct relay_log_buffer *buffer = get_relay_log_buffer();
+    struct relay_log_record *record;
+    unsigned int i;
+
+    if (!buffer) return;
+    record = alloc_relay_log_record( buffer );
+    record->time    = get_relay_log_time();
+    record->tid     = buffer->tid;
+    record->module  = data->log_id;
+    record->ordinal = ordinal;
+    record->type    = RELAY_LOG_CALL;
+    record->nb_args = min( nb_args, 255 );
+    record->retaddr = retaddr;
+    for (i = 0; i < min( nb_args, RELAY_LOG_MAX_ARGS ); i++) record->args[i] = stack[i];
+    commit_relay_log_record( buffer );
+}
+
+static void log_relay_ret( const struct relay_private_data *data, WORD ordinal,
+                           ULONG_PTR retaddr, ULONG64 retval )
+{
+    struct relay_log_buffer *buffer = get_relay_log_buffer();
+    struct relay_log_record *record;
+
+    if (!buffer) return;
+    record = alloc_relay_log_record( buffer );
+    record->time    = get_relay_log_time();
+    record->tid     = buffer->tid;
+    record->module  = data->log_id;
+    record->ordinal = ordinal;
+    record->type    = RELAY_LOG_RET;
+    record->nb_args = 0;
+    record->retaddr = retaddr;
+    record->args[0] = retval;
+    commit_relay_log_record( buffer );
+}
+
+/***********************************************************************
+ *           open_relay_log
+ *
+ * Open the binary relay log file if one is configured. The process id
+ * is appended to the file name so that child processes get their own log.
+ */
+static void open_relay_log( HKEY hkey )
+{
+    char buffer[offsetof(KEY_VALUE_PARTIAL_INFORMATION, Data) + MAX_PATH * sizeof(WCHAR)];
+    KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)buffer;
+    WCHAR path[MAX_PATH + 16], expanded[MAX_PATH], *file;
+    struct relay_log_header header;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING name, nt_name;
+    IO_STATUS_BLOCK io;
+    DWORD count;
+
+    RtlInitUnicodeString( &name, L"RelayLogFile" );
+    if (NtQueryValueKey( hkey, &name, KeyValuePartialInformation, buffer, sizeof(buffer) - sizeof(WCHAR), &count ))
+        return;
+    if (info->Type != REG_SZ && info->Type != REG_EXPAND_SZ) return;
+    file = (WCHAR *)info->Data;
+    file[info->DataLength / sizeof(WCHAR)] = 0;
+    if (info->Type == REG_EXPAND_SZ)
+    {
+        if (RtlExpandEnvironmentStrings( NULL, file, wcslen(file), expanded, ARRAY_SIZE(expanded), NULL ))
+            return;
+        file = expanded;
+    }
+    _snwprintf( path, ARRAY_SIZE(path), L"%s.%04x", file,
+                HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess ));
+
+    if (!RtlDosPathNameToNtPathName_U( path, &nt_name, NULL, NULL )) return;
+    InitializeObjectAttributes( &attr, &nt_name, OBJ_CASE_INSENSITIVE, 0, NULL );
+    if (NtCreateFile( &relay_log_file, GENERIC_WRITE | SYNCHRONIZE, &attr, &io, NULL, FILE_ATTRIBUTE_NORMAL,
+                      FILE_SHARE_READ, FILE_OVERWRITE_IF,
+                      FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT, NULL, 0 ))
+    {
+        ERR( "failed to create relay log %s\n", debugstr_w(path) );
+        relay_log_file = 0;
+    }
+    RtlFreeUnicodeString( &nt_name );
+    if (!relay_log_file) return;
+
+    TRACE( "writing binary relay log to %s\n", debugstr_w(path) );
+    header.magic    = RELAY_LOG_MAGIC;
+    header.version  = RELAY_LOG_VERSION;
+    header.pid      = HandleToULong( NtCurrentTeb()->ClientId.UniqueProcess );
+    header.ptr_size = sizeof(void *);
+    NtWriteFile( relay_log_file, 0, NULL, NULL, &io, &header, sizeof(header), NULL, NULL );
+    write_relay_log_clock();
+}
+
 /***********************************************************************
  *           init_debug_lists
  *
@@ -190,6 +605,7 @@ static DWORD WINAPI init_debug_lists( RTL_RUN_ONCE *once, void *param, void **co
     debug_from_relay_excludelist = load_list( hkey, L"RelayFromExclude" );
     debug_from_snoop_includelist = load_list( hkey, L"SnoopFromInclude" );
     debug_from_snoop_excludelist = load_list( hkey, L"SnoopFromExclude" );
+    open_relay_log( hkey );
 
     NtClose( hkey );
     return TRUE;
@@ -317,6 +733,18 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
     struct relay_entry_point *entry_point = data->entry_points + ordinal;
     unsigned int i, pos;
 
+    if (relay_log_file)
+    {
+        for (i = pos = 0; !is_ret_val( arg_types[i] ); i++)
+        {
+            if (arg_types[i] == 'j' || arg_types[i] == 'd') pos += 2;
+            else if (arg_types[i] == 'k') pos += 4;
+            else pos++;
+        }
+        log_relay_call( data, ordinal, (const ULONG_PTR *)stack, pos, stack[-1] );
+        goto done;
+    }
+
     TRACE( "\1Call %s(", func_name( data, ordinal ));
 
     for (i = pos = 0; !is_ret_val( arg_types[i] ); i++)
@@ -351,13 +779,14 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
         }
         if (!is_ret_val( arg_types[i+1] )) TRACE( "," );
     }
+    TRACE( ") ret=%08x\n", stack[-1] );
+done:
     *nb_args = pos;
     if (arg_types[0] == 't')
     {
         *nb_args |= 0x80000000;  /* thiscall/fastcall */
         if (arg_types[1] == 't') *nb_args |= 0x40000000;  /* fastcall */
     }
-    TRACE( ") ret=%08x\n", stack[-1] );
     return entry_point->orig_func;
 }
 
@@ -369,6 +798,12 @@ DECLSPEC_HIDDEN void WINAPI relay_trace_exit( struct relay_descr *descr, unsigne
 {
     const char *arg_types = descr->args_string + HIWORD(idx);
 
+    if (relay_log_file)
+    {
+        log_relay_ret( descr->private, LOWORD(idx), (ULONG_PTR)retaddr, retval );
+        return;
+    }
+
     TRACE( "\1Ret  %s()", func_name( descr->private, LOWORD(idx) ));
 
     while (!is_ret_val( *arg_types )) arg_types++;
@@ -460,6 +895,59 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
     const union fpregs { float s[16]; double d[8]; } *fpstack = (const union fpregs *)stack - 1;
 #endif
 
+    if (relay_log_file)
+    {
+        const DWORD *retaddr = stack;
+
+        for (i = pos = 0; !is_ret_val( arg_types[i] ); i++)
+        {
+            switch (arg_types[i])
+            {
+            case 'j': /* int64 */
+                pos = ((pos + 1) & ~1) + 2;
+                break;
+            case 'k': /* int128 */
+                pos += 4;
+                break;
+            case 'f': /* float */
+#ifndef __SOFTFP__
+                if (!(float_pos % 2)) float_pos = max( float_pos, double_pos * 2 );
+                if (float_pos < 16)
+                {
+                    float_pos++;
+                    break;
+                }
+#endif
+                pos++;
+                break;
+            case 'd': /* double */
+#ifndef __SOFTFP__
+                double_pos = max( (float_pos + 1) / 2, double_pos );
+                if (double_pos < 8)
+                {
+                    double_pos++;
+                    break;
+                }
+#endif
+                pos = ((pos + 1) & ~1) + 2;
+                break;
+            default:
+                pos++;
+                break;
+            }
+        }
+#ifndef __SOFTFP__
+        if (float_pos || double_pos)
+        {
+            pos |= 0x80000000;
+            retaddr = (const DWORD *)fpstack;  /* retaddr is below the fp regs */
+        }
+#endif
+        log_relay_call( data, ordinal, (const ULONG_PTR *)stack, pos & 0xffff, retaddr[-1] );
+        *nb_args = pos;
+        return entry_point->orig_func;
+    }
+
     TRACE( "\1Call %s(", func_name( data, ordinal ));
 
     for (i = pos = 0; !is_ret_val( arg_types[i] ); i++)
@@ -533,6 +1021,12 @@ DECLSPEC_HIDDEN void WINAPI relay_trace_exit( struct relay_descr *descr, unsigne
 {
     const char *arg_types = descr->args_string + HIWORD(idx);
 
+    if (relay_log_file)
+    {
+        log_relay_ret( descr->private, LOWORD(idx), retaddr, retval );
+        return;
+    }
+
     TRACE( "\1Ret  %s()", func_name( descr->private, LOWORD(idx) ));
 
     while (!is_ret_val( *arg_types )) arg_types++;
@@ -610,6 +1104,14 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
     struct relay_entry_point *entry_point = data->entry_points + ordinal;
     unsigned int i;
 
+    if (relay_log_file)
+    {
+        for (i = 0; !is_ret_val( arg_types[i] ); i++) ;
+        log_relay_call( data, ordinal, (const ULONG_PTR *)stack, i, stack[-1] );
+        *nb_args = i;
+        return entry_point->orig_func;
+    }
+
     TRACE( "\1Call %s(", func_name( data, ordinal ));
 
     for (i = 0; !is_ret_val( arg_types[i] ); i++)
@@ -640,6 +1142,12 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
 DECLSPEC_HIDDEN void WINAPI relay_trace_exit( struct relay_descr *descr, unsigned int idx,
                                               INT_PTR retaddr, INT_PTR retval )
 {
+    if (relay_log_file)
+    {
+        log_relay_ret( descr->private, LOWORD(idx), retaddr, retval );
+        return;
+    }
+
     TRACE( "\1Ret  %s() retval=%08zx ret=%08zx\n",
            func_name( descr->private, LOWORD(idx) ), retval, retaddr );
 }
@@ -710,6 +1218,14 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
     struct relay_entry_point *entry_point = data->entry_points + ordinal;
     unsigned int i;
 
+    if (relay_log_file)
+    {
+        for (i = 0; !is_ret_val( arg_types[i] ); i++) ;
+        log_relay_call( data, ordinal, (const ULONG_PTR *)stack, i, stack[-1] );
+        *nb_args = i;
+        return entry_point->orig_func;
+    }
+
     TRACE( "\1Call %s(", func_name( data, ordinal ));
 
     for (i = 0; !is_ret_val( arg_types[i] ); i++)
@@ -746,6 +1262,12 @@ DECLSPEC_HIDDEN void * WINAPI relay_trace_entry( struct relay_descr *descr, unsi
 DECLSPEC_HIDDEN void WINAPI relay_trace_exit( struct relay_descr *descr, unsigned int idx,
                                               INT_PTR retaddr, INT_PTR retval )
 {
+    if (relay_log_file)
+    {
+        log_relay_ret( descr->private, LOWORD(idx), retaddr, retval );
+        return;
+    }
+
     TRACE( "\1Ret  %s() retval=%08zx ret=%08zx\n",
            func_name( descr->private, LOWORD(idx) ), retval, retaddr );
 }
@@ -930,6 +1452,55 @@ void RELAY_SetupDLL( HMODULE module )
     }
     if (old_prot != PAGE_READWRITE)
         NtProtectVirtualMemory( NtCurrentProcess(), &func_base, &func_size, old_prot, &old_prot );
+
+    if (relay_log_file)
+    {
+        data->log_id = InterlockedIncrement( &relay_log_module_count );
+        write_relay_log_module( data, exports->NumberOfFunctions );
+    }
+}
+
+
+/***********************************************************************
+ *           RELAY_ThreadDetach
+ *
+ * Flush the binary relay log of the current thread. Its buffer is released
+ * by the writer thread once the thread is gone, so that relay calls made
+ * later in the thread exit path don't allocate a new one.
+ */
+void RELAY_ThreadDetach(void)
+{
+    LONG tid = HandleToLong( NtCurrentTeb()->ClientId.UniqueThread );
+    unsigned int i;
+
+    if (!relay_log_file) return;
+
+    for (i = 0; i < RELAY_LOG_MAX_THREADS; i++)
+    {
+        if (relay_log_buffers[i].tid != tid) continue;
+        relay_log_buffers[i].detached = TRUE;
+        RtlEnterCriticalSection( &relay_log_section );
+        flush_relay_log_buffer( &relay_log_buffers[i] );
+        RtlLeaveCriticalSection( &relay_log_section );
+        break;
+    }
+}
+
+
+/***********************************************************************
+ *           RELAY_ProcessDetach
+ *
+ * Flush the binary relay log at process exit.
+ */
+void RELAY_ProcessDetach(void)
+{
+    if (!relay_log_file) return;
+
+    /* the other threads are already terminated, and the writer thread
+     * may have been killed while holding the lock, so don't take it */
+    flush_relay_log();
+    NtClose( relay_log_file );
+    relay_log_file = 0;
 }
 
 #else  /* __i386__ || __x86_64__ || __arm__ || __aarch64__ */
@@ -944,6 +1515,14 @@ void RELAY_SetupDLL( HMODULE module )
 {
 }
 
+void RELAY_ThreadDetach(void)
+{
+}
+
+void RELAY_ProcessDetach(void)
+{
+}
+
 #endif  /* __i386__ || __x86_64__ || __arm__ || __aarch64__ */
 
 
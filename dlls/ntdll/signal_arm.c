@@ -148,7 +148,7 @@ static NTSTATUS virtual_unwind( ULONG type, DISPATCHER_CONTEXT *dispatch, CONTEX
 
     if ((dispatch->FunctionEntry = lookup_function_info(
              context->Pc - (dispatch->ControlPcIsUnwound ? 2 : 0),
-             (ULONG_PTR*)&dispatch->ImageBase, &module )))
+             (ULONG_PTR*)&dispatch->ImageBase, &module, dispatch->HistoryTable )))
     {
         dispatch->LanguageHandler = RtlVirtualUnwind( type, dispatch->ImageBase, context->Pc,
                                                       dispatch->FunctionEntry, context,
@@ -360,6 +360,7 @@ static NTSTATUS call_function_handlers( EXCEPTION_RECORD *rec, CONTEXT *orig_con
     NTSTATUS status;
 
     context = *orig_context;
+    memset( &table, 0, sizeof(table) );
     dispatch.TargetPc      = 0;
     dispatch.ContextRecord = &context;
     dispatch.HistoryTable  = &table;
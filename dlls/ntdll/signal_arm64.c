@@ -180,7 +180,7 @@ static NTSTATUS virtual_unwind( ULONG type, DISPATCHER_CONTEXT *dispatch, CONTEX
 
     if ((dispatch->FunctionEntry = lookup_function_info(
              context->Pc - (dispatch->ControlPcIsUnwound ? 4 : 0),
-             &dispatch->ImageBase, &module )))
+             &dispatch->ImageBase, &module, dispatch->HistoryTable )))
     {
         dispatch->LanguageHandler = RtlVirtualUnwind( type, dispatch->ImageBase, context->Pc,
                                                       dispatch->FunctionEntry, context,
@@ -392,6 +392,7 @@ static NTSTATUS call_function_handlers( EXCEPTION_RECORD *rec, CONTEXT *orig_con
     NTSTATUS status;
 
     context = *orig_context;
+    memset( &table, 0, sizeof(table) );
     dispatch.TargetPc      = 0;
     dispatch.ContextRecord = &context;
     dispatch.HistoryTable  = &table;
@@ -266,7 +266,8 @@ static NTSTATUS virtual_unwind( ULONG type, DISPATCHER_CONTEXT *dispatch, CONTEX
 
     /* first look for PE exception information */
 
-    if ((dispatch->FunctionEntry = lookup_function_info( context->Rip, &dispatch->ImageBase, &module )))
+    if ((dispatch->FunctionEntry = lookup_function_info( context->Rip, &dispatch->ImageBase, &module,
+                                                          dispatch->HistoryTable )))
     {
         dispatch->LanguageHandler = RtlVirtualUnwind( type, dispatch->ImageBase, context->Rip,
                                                       dispatch->FunctionEntry, context,
@@ -432,6 +433,7 @@ static NTSTATUS call_stack_handlers( EXCEPTION_RECORD *rec, CONTEXT *orig_contex
     context = *orig_context;
     context.ContextFlags &= ~0x40; /* Clear xstate flag. */
 
+    memset( &table, 0, sizeof(table) );
     dispatch.TargetIp      = 0;
     dispatch.ContextRecord = &context;
     dispatch.HistoryTable  = &table;
@@ -1544,6 +1546,145 @@ static inline ULONG hash_pointers( void **ptrs, ULONG count )
 }
 
 
+/* unwind information of a call site, reduced to what's needed to walk the stack */
+struct stack_walk_entry
+{
+    ULONG64 pc;
+    LONG    generation;     /* value of module_unload_count when the entry was built */
+    BOOL    simple;         /* unwind info can be applied with the fields below */
+    ULONG   frame_size;     /* offset of the return address from the frame */
+    BYTE    frame_reg;
+    BYTE    frame_offset;
+    BYTE    saved_count;
+    BYTE    saved_regs[8];
+    ULONG   saved_offsets[8];
+};
+
+#define STACK_WALK_CACHE_SIZE 512
+
+static struct stack_walk_entry stack_walk_cache[STACK_WALK_CACHE_SIZE];
+static RTL_SRWLOCK stack_walk_lock = RTL_SRWLOCK_INIT;
+
+static BOOL add_saved_reg( struct stack_walk_entry *entry, BYTE reg, ULONG offset )
+{
+    if (entry->saved_count == ARRAY_SIZE(entry->saved_regs)) return FALSE;
+    entry->saved_regs[entry->saved_count] = reg;
+    entry->saved_offsets[entry->saved_count] = offset;
+    entry->saved_count++;
+    return TRUE;
+}
+
+/* reduce the unwind info of a function to frame offsets; fails for anything that
+ * needs the full RtlVirtualUnwind() treatment (prologs, chained info, machine frames) */
+static BOOL build_stack_walk_entry( ULONG64 base, ULONG64 pc, RUNTIME_FUNCTION *function,
+                                    struct stack_walk_entry *entry )
+{
+    struct UNWIND_INFO *info = (struct UNWIND_INFO *)((char *)base + function->UnwindData);
+    BOOL relative = !info->frame_reg;  /* whether offsets are relative to the frame yet */
+    ULONG pos = 0;
+    unsigned int i;
+
+    if (info->version != 1 && info->version != 2) return FALSE;
+    if (info->flags & UNW_FLAG_CHAININFO) return FALSE;
+    if (pc < base + function->BeginAddress + info->prolog) return FALSE;
+
+    /* return addresses can only be at the start of an epilog, where executing
+     * the epilog and reverting the prolog give the same result */
+
+    for (i = 0; i < info->count; i += get_opcode_size(info->opcodes[i]))
+    {
+        switch (info->opcodes[i].code)
+        {
+        case UWOP_PUSH_NONVOL:
+            if (!relative || !add_saved_reg( entry, info->opcodes[i].info, pos )) return FALSE;
+            pos += sizeof(ULONG64);
+            break;
+        case UWOP_ALLOC_LARGE:
+            if (info->opcodes[i].info) pos += *(DWORD *)&info->opcodes[i+1];
+            else pos += *(USHORT *)&info->opcodes[i+1] * 8;
+            break;
+        case UWOP_ALLOC_SMALL:
+            pos += (info->opcodes[i].info + 1) * 8;
+            break;
+        case UWOP_SET_FPREG:
+            if (!info->frame_reg) return FALSE;
+            relative = TRUE;
+            pos = 0;
+            break;
+        case UWOP_SAVE_NONVOL:
+            if (!add_saved_reg( entry, info->opcodes[i].info, *(USHORT *)&info->opcodes[i+1] * 8 )) return FALSE;
+            break;
+        case UWOP_SAVE_NONVOL_FAR:
+            if (!add_saved_reg( entry, info->opcodes[i].info, *(DWORD *)&info->opcodes[i+1] )) return FALSE;
+            break;
+        case UWOP_SAVE_XMM128:
+        case UWOP_SAVE_XMM128_FAR:
+            break;  /* not needed to walk the stack */
+        case UWOP_EPILOG:
+            if (info->version == 2) break;
+            return FALSE;
+        default:
+            return FALSE;
+        }
+    }
+    if (!relative) return FALSE;
+
+    entry->frame_size = pos;
+    entry->frame_reg = info->frame_reg;
+    entry->frame_offset = info->frame_offset;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           stack_walk_unwind
+ *
+ * Equivalent of virtual_unwind( UNW_FLAG_NHANDLER ) for stack walking, using
+ * a cache of the unwind info of each call site.
+ */
+static NTSTATUS stack_walk_unwind( DISPATCHER_CONTEXT *dispatch, CONTEXT *context )
+{
+    ULONG64 pc = context->Rip, frame;
+    struct stack_walk_entry *cached = &stack_walk_cache[(ULONG)(pc ^ (pc >> 12)) % STACK_WALK_CACHE_SIZE];
+    struct stack_walk_entry entry;
+    LONG generation = module_unload_count;
+    BOOL found;
+    unsigned int i;
+
+    RtlAcquireSRWLockShared( &stack_walk_lock );
+    if ((found = (cached->pc == pc && cached->generation == generation))) entry = *cached;
+    RtlReleaseSRWLockShared( &stack_walk_lock );
+
+    if (!found)
+    {
+        LDR_DATA_TABLE_ENTRY *module;
+        RUNTIME_FUNCTION *function;
+        ULONG_PTR base;
+
+        memset( &entry, 0, sizeof(entry) );
+        entry.pc = pc;
+        entry.generation = generation;
+        /* dynamic function tables may change at any time, only cache entries from images */
+        if ((function = lookup_function_info( pc, &base, &module, NULL )) && module)
+            entry.simple = build_stack_walk_entry( base, pc, function, &entry );
+
+        RtlAcquireSRWLockExclusive( &stack_walk_lock );
+        *cached = entry;
+        RtlReleaseSRWLockExclusive( &stack_walk_lock );
+    }
+
+    if (!entry.simple) return virtual_unwind( UNW_FLAG_NHANDLER, dispatch, context );
+
+    frame = entry.frame_reg ? get_int_reg( context, entry.frame_reg ) - entry.frame_offset * 16 : context->Rsp;
+    for (i = 0; i < entry.saved_count; i++)
+        set_int_reg( context, NULL, entry.saved_regs[i], (ULONG64 *)(frame + entry.saved_offsets[i]) );
+    context->Rip = *(ULONG64 *)(frame + entry.frame_size);
+    context->Rsp = frame + entry.frame_size + sizeof(ULONG64);
+    dispatch->EstablisherFrame = frame;
+    dispatch->ControlPc = pc;
+    return STATUS_SUCCESS;
+}
+
+
 /*************************************************************************
  *		RtlCaptureStackBackTrace (NTDLL.@)
  */
@@ -1559,13 +1700,14 @@ USHORT WINAPI RtlCaptureStackBackTrace( ULONG skip, ULONG count, PVOID *buffer,
     TRACE( "(%u, %u, %p, %p)\n", skip, count, buffer, hash );
 
     RtlCaptureContext( &context );
+    memset( &table, 0, sizeof(table) );
     dispatch.TargetIp      = 0;
     dispatch.ContextRecord = &context;
     dispatch.HistoryTable  = &table;
     if (hash) *hash = 0;
     for (i = 0; i < skip + count; i++)
     {
-        status = virtual_unwind( UNW_FLAG_NHANDLER, &dispatch, &context );
+        status = stack_walk_unwind( &dispatch, &context );
         if (status != STATUS_SUCCESS) return i;
 
         if (!dispatch.EstablisherFrame) break;
@@ -26,12 +26,16 @@
 
 #include <assert.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -66,6 +70,25 @@ static struct __wine_debug_channel *debug_options;
 
 static const char * const debug_classes[] = { "fixme", "err", "warn", "trace" };
 
+/* ring buffer used for asynchronous output, see WINE_DEBUG_ASYNC */
+
+#define DEBUG_RING_SLOTS 4096  /* must be a power of 2 */
+
+struct debug_ring_slot
+{
+    unsigned int seq;           /* sequence number, equal to the slot position when free */
+    unsigned int len;           /* length of the data */
+    char         data[1024];
+};
+
+static struct debug_ring_slot *debug_ring;
+static unsigned int debug_ring_head;     /* next slot to fill */
+static unsigned int debug_ring_tail;     /* next slot to write out, protected by debug_ring_mutex */
+static unsigned int debug_ring_stalls;   /* number of drains blocked by an unpublished slot */
+static unsigned int debug_ring_dropped;  /* number of chunks dropped because the ring was full */
+static pthread_mutex_t debug_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int debug_ring_wake[2] = { -1, -1 };  /* pipe used to wake up the writer, safe to use in signal handlers */
+
 /* get the debug info pointer for the current thread */
 static inline struct debug_info *get_info(void)
 {
@@ -253,12 +276,176 @@ const char * __cdecl __wine_dbg_strdup( const char *str )
     return memcpy( info->strings + pos, str, n );
 }
 
+/* add a chunk of output to the ring, without ever blocking; return FALSE if the ring is full */
+static BOOL put_debug_ring( const char *str, unsigned int len )
+{
+    struct debug_ring_slot *slot;
+    unsigned int pos, seq;
+
+    for (;;)
+    {
+        pos = __atomic_load_n( &debug_ring_head, __ATOMIC_RELAXED );
+        slot = &debug_ring[pos % DEBUG_RING_SLOTS];
+        seq = __atomic_load_n( &slot->seq, __ATOMIC_ACQUIRE );
+        if (seq == pos)
+        {
+            if (__sync_val_compare_and_swap( &debug_ring_head, pos, pos + 1 ) == pos) break;
+        }
+        else if ((int)(seq - pos) < 0) return FALSE;  /* not written out yet */
+    }
+    memcpy( slot->data, str, len );
+    slot->len = len;
+    /* the writer may have given up on us and skipped the slot, it's already counted as dropped then */
+    if (!__atomic_compare_exchange_n( &slot->seq, &pos, pos + 1, FALSE, __ATOMIC_RELEASE, __ATOMIC_RELAXED ))
+        return TRUE;
+
+    /* wake up the writer early if the ring is filling up */
+    if (pos - __atomic_load_n( &debug_ring_tail, __ATOMIC_RELAXED ) == DEBUG_RING_SLOTS / 2)
+    {
+        static const char byte;
+        int ret = write( debug_ring_wake[1], &byte, 1 );
+        (void)ret;  /* the pipe is already full if it fails, so the writer is awake */
+    }
+    return TRUE;
+}
+
+static void write_all( const char *str, unsigned int len )
+{
+    int ret;
+
+    while (len)
+    {
+        if ((ret = write( 2, str, len )) <= 0) break;
+        str += ret;
+        len -= ret;
+    }
+}
+
+/* write out the pending ring contents; debug_ring_mutex must be held
+ *
+ * A slot that has been claimed but not published yet blocks the following ones. If its
+ * producer doesn't get to publish it for a while, or if this is the final flush, the slot
+ * is skipped, since the producer may have been killed or may be stuck in a signal handler.
+ */
+static void drain_debug_ring( BOOL final )
+{
+    static char buffer[65536];  /* not on the stack, this can run on the signal stack */
+    struct debug_ring_slot *slot;
+    unsigned int size = 0, dropped, seq;
+
+    for (;;)
+    {
+        slot = &debug_ring[debug_ring_tail % DEBUG_RING_SLOTS];
+        seq = __atomic_load_n( &slot->seq, __ATOMIC_ACQUIRE );
+        if (seq == debug_ring_tail && debug_ring_tail != __atomic_load_n( &debug_ring_head, __ATOMIC_RELAXED ) &&
+            (final || ++debug_ring_stalls >= 100 /* about 1s */) &&
+            __atomic_compare_exchange_n( &slot->seq, &seq, debug_ring_tail + DEBUG_RING_SLOTS,
+                                         FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ))
+        {
+            __atomic_add_fetch( &debug_ring_dropped, 1, __ATOMIC_SEQ_CST );
+            __atomic_store_n( &debug_ring_tail, debug_ring_tail + 1, __ATOMIC_RELAXED );
+            debug_ring_stalls = 0;
+            continue;
+        }
+        if (seq != debug_ring_tail + 1) break;
+        debug_ring_stalls = 0;
+        if (size + slot->len > sizeof(buffer))
+        {
+            write_all( buffer, size );
+            size = 0;
+        }
+        memcpy( buffer + size, slot->data, slot->len );
+        size += slot->len;
+        __atomic_store_n( &slot->seq, debug_ring_tail + DEBUG_RING_SLOTS, __ATOMIC_RELEASE );
+        __atomic_store_n( &debug_ring_tail, debug_ring_tail + 1, __ATOMIC_RELAXED );
+    }
+    if (size) write_all( buffer, size );
+
+    if ((dropped = __atomic_exchange_n( &debug_ring_dropped, 0, __ATOMIC_SEQ_CST )))
+    {
+        size = sprintf( buffer, "wine_dbg_output: ring buffer full, %u chunks dropped\n", dropped );
+        write_all( buffer, size );
+    }
+}
+
+static void *debug_ring_thread( void *arg )
+{
+    struct pollfd pfd = { debug_ring_wake[0], POLLIN };
+    char buffer[64];
+
+    for (;;)
+    {
+        pthread_mutex_lock( &debug_ring_mutex );
+        drain_debug_ring( FALSE );
+        pthread_mutex_unlock( &debug_ring_mutex );
+        if (poll( &pfd, 1, 10 /* ms */ ) > 0)
+            while (read( debug_ring_wake[0], buffer, sizeof(buffer) ) > 0) /* nothing */;
+    }
+    return NULL;
+}
+
+/* flush the asynchronous output, called at process exit */
+void dbg_flush(void)
+{
+    if (!debug_ring) return;
+    pthread_mutex_lock( &debug_ring_mutex );
+    drain_debug_ring( TRUE );
+    pthread_mutex_unlock( &debug_ring_mutex );
+}
+
+/* set up the output ring and its writer thread */
+static void init_debug_ring(void)
+{
+    const char *env = getenv( "WINE_DEBUG_ASYNC" );
+    pthread_attr_t attr;
+    pthread_t thread;
+    sigset_t sigset, old_set;
+    unsigned int i;
+    void *ptr;
+
+    if (!env || !atoi( env )) return;
+
+    ptr = mmap( NULL, DEBUG_RING_SLOTS * sizeof(*debug_ring), PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANON, -1, 0 );
+    if (ptr == MAP_FAILED) return;
+    if (server_pipe( debug_ring_wake ) == -1)
+    {
+        munmap( ptr, DEBUG_RING_SLOTS * sizeof(*debug_ring) );
+        return;
+    }
+    fcntl( debug_ring_wake[0], F_SETFL, O_NONBLOCK );
+    fcntl( debug_ring_wake[1], F_SETFL, O_NONBLOCK );
+    debug_ring = ptr;
+    for (i = 0; i < DEBUG_RING_SLOTS; i++) debug_ring[i].seq = i;
+
+    /* the writer thread is not a Wine thread, it must not receive any signals */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_BLOCK, &sigset, &old_set );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    if (pthread_create( &thread, &attr, debug_ring_thread, NULL ))
+    {
+        munmap( debug_ring, DEBUG_RING_SLOTS * sizeof(*debug_ring) );
+        debug_ring = NULL;
+        close( debug_ring_wake[0] );
+        close( debug_ring_wake[1] );
+    }
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_set, NULL );
+    if (debug_ring) atexit( dbg_flush );
+}
+
 /***********************************************************************
  *		__wine_dbg_write  (NTDLL.@)
  */
 int WINAPI __wine_dbg_write( const char *str, unsigned int len )
 {
-    return write( 2, str, len );
+    /* messages that don't fit in a slot are written directly, so that they can't be
+     * interleaved with other threads' output; they may overtake queued lines though */
+    if (!debug_ring || len > sizeof(debug_ring->data)) return write( 2, str, len );
+
+    if (!put_debug_ring( str, len )) __atomic_add_fetch( &debug_ring_dropped, 1, __ATOMIC_SEQ_CST );
+    return len;
 }
 
 /***********************************************************************
@@ -298,7 +485,7 @@ int __cdecl __wine_dbg_header( enum __wine_debug_class cls, struct __wine_debug_
 
     if (init_done)
     {
-        if (TRACE_ON(microsecs))
+        if (TRACE_ON(microsecs) || debug_ring)  /* lines are written out later, always timestamp them */
         {
             LARGE_INTEGER counter, frequency, microsecs;
             NtQueryPerformanceCounter(&counter, &frequency);
@@ -338,6 +525,8 @@ void dbg_init(void)
     debug_options = options;
     options[nb_debug_options] = default_option;
     init_done = TRUE;
+
+    init_debug_ring();
 }
 
 
@@ -556,6 +556,22 @@ static BOOL is_dynamic_env_var( const char *var )
             STARTS_WITH( var, "WINESERVERSOCKET=" ));
 }
 
+/* length of the run of 7-bit ASCII chars at the start of a UTF-8 string, checked a word at a time */
+static inline unsigned int get_utf8_ascii_run( const char *src, unsigned int len )
+{
+    unsigned int pos = 0;
+    UINT64 val;
+
+    while (pos + sizeof(val) <= len)
+    {
+        memcpy( &val, src + pos, sizeof(val) );
+        if (val & 0x8080808080808080ull) break;
+        pos += sizeof(val);
+    }
+    while (pos < len && (unsigned char)src[pos] < 0x80) pos++;
+    return pos;
+}
+
 static unsigned int decode_utf8_char( unsigned char ch, const char **str, const char *strend )
 {
     /* number of following bytes in sequence based on first byte value (for bytes above 0x7f) */
@@ -2546,7 +2562,7 @@ WCHAR WINAPI RtlDowncaseUnicodeChar( WCHAR wch )
  */
 NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, const char *src, DWORD srclen )
 {
-    unsigned int res, len;
+    unsigned int i, res, len;
     NTSTATUS status = STATUS_SUCCESS;
     const char *srcend = src + srclen;
     WCHAR *dstend;
@@ -2561,7 +2577,13 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         for (len = 0; src < srcend; len++)
         {
             unsigned char ch = *src++;
-            if (ch < 0x80) continue;
+            if (ch < 0x80)
+            {
+                res = get_utf8_ascii_run( src, srcend - src );
+                src += res;
+                len += res;
+                continue;
+            }
             if ((res = decode_utf8_char( ch, &src, srcend )) > 0x10ffff)
                 status = STATUS_SOME_NOT_MAPPED;
             else
@@ -2577,6 +2599,10 @@ NTSTATUS WINAPI RtlUTF8ToUnicodeN( WCHAR *dst, DWORD dstlen, DWORD *reslen, cons
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
             *dst++ = ch;
+            len = get_utf8_ascii_run( src, min( srcend - src, dstend - dst ));
+            for (i = 0; i < len; i++) dst[i] = (unsigned char)src[i];
+            src += len;
+            dst += len;
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
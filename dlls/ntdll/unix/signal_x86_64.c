@@ -38,6 +38,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <dlfcn.h>
 #ifdef HAVE_MACHINE_SYSARCH_H
 # include <machine/sysarch.h>
 #endif
@@ -291,6 +292,7 @@ C_ASSERT( sizeof(struct stack_layout) == 0x590 ); /* Should match the size in ca
 #define SYSCALL_HAVE_XSAVEC      2
 #define SYSCALL_HAVE_PTHREAD_TEB 4
 #define SYSCALL_HAVE_WRFSGSBASE  8
+#define SYSCALL_PROFILE         16
 
 static unsigned int syscall_flags;
 
@@ -354,6 +356,7 @@ struct amd64_thread_data
     void                 *exit_frame;    /* 0320 exit frame pointer */
     struct syscall_frame *syscall_frame; /* 0328 syscall frame pointer */
     void                 *pthread_teb;   /* 0330 thread data for pthread */
+    struct syscall_stats *syscall_stats; /* 0338 syscall profiling counters */
 };
 
 C_ASSERT( sizeof(struct amd64_thread_data) <= sizeof(((struct ntdll_thread_data *)0)->cpu_data) );
@@ -3074,6 +3077,94 @@ static void quit_handler( int signal, siginfo_t *siginfo, void *ucontext )
 }
 
 
+/* per-thread syscall counters, enabled with WINE_SYSCALL_PROFILE=1 */
+struct syscall_counter
+{
+    ULONG64 count;
+    ULONG64 cycles;
+};
+
+struct syscall_stats
+{
+    struct list             entry;
+    DWORD                   tid;
+    struct syscall_counter *counters[ARRAY_SIZE(KeServiceDescriptorTable)];
+};
+
+static struct list syscall_stats_list = LIST_INIT( syscall_stats_list );
+static pthread_mutex_t syscall_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static LONG syscall_stats_dump_pending;
+
+static void dump_syscall_stats(void)
+{
+    struct syscall_stats *stats;
+    unsigned int i, id;
+    Dl_info info;
+
+    pthread_mutex_lock( &syscall_stats_mutex );
+    LIST_FOR_EACH_ENTRY( stats, &syscall_stats_list, struct syscall_stats, entry )
+    {
+        for (i = 0; i < ARRAY_SIZE(stats->counters); i++)
+        {
+            if (!stats->counters[i]) continue;
+            for (id = 0; id < KeServiceDescriptorTable[i].ServiceLimit; id++)
+            {
+                const struct syscall_counter *counter = &stats->counters[i][id];
+                void *func = (void *)KeServiceDescriptorTable[i].ServiceTable[id];
+
+                if (!counter->count) continue;
+                fprintf( stderr, "%04x:syscall %04x %s: %llu calls, %llu cycles, %llu cycles/call\n",
+                         (int)stats->tid, (i << 12) | id,
+                         dladdr( func, &info ) && info.dli_sname ? info.dli_sname : "?",
+                         (unsigned long long)counter->count, (unsigned long long)counter->cycles,
+                         (unsigned long long)(counter->cycles / counter->count) );
+            }
+        }
+    }
+    pthread_mutex_unlock( &syscall_stats_mutex );
+}
+
+/***********************************************************************
+ *           update_syscall_stats
+ *
+ * Called by the syscall dispatcher after each syscall when profiling is enabled.
+ */
+void WINAPI DECLSPEC_HIDDEN update_syscall_stats( SYSTEM_SERVICE_TABLE *table, ULONG id, ULONG64 cycles )
+{
+    struct syscall_stats *stats = amd64_thread_data()->syscall_stats;
+    unsigned int idx = table - KeServiceDescriptorTable;
+
+    if (!stats)
+    {
+        if (!(stats = calloc( 1, sizeof(*stats) ))) return;
+        stats->tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+        pthread_mutex_lock( &syscall_stats_mutex );
+        list_add_tail( &syscall_stats_list, &stats->entry );
+        pthread_mutex_unlock( &syscall_stats_mutex );
+        amd64_thread_data()->syscall_stats = stats;
+    }
+    if (!stats->counters[idx] && !(stats->counters[idx] = calloc( table->ServiceLimit, sizeof(**stats->counters) )))
+        return;
+    stats->counters[idx][id].count++;
+    stats->counters[idx][id].cycles += cycles;
+
+    if (syscall_stats_dump_pending && InterlockedExchange( &syscall_stats_dump_pending, 0 ))
+        dump_syscall_stats();
+}
+
+
+/**********************************************************************
+ *		usr2_handler
+ *
+ * Handler for SIGUSR2, used to request a dump of the syscall counters.
+ * The dump is done by the next thread entering a syscall.
+ */
+static void usr2_handler( int signal, siginfo_t *siginfo, void *ucontext )
+{
+    syscall_stats_dump_pending = 1;
+}
+
+
 /**********************************************************************
  *		usr1_handler
  *
@@ -3247,6 +3338,7 @@ void signal_init_thread( TEB *teb )
 void signal_init_process(void)
 {
     struct sigaction sig_act;
+    const char *env;
     void *ptr, *kernel_stack = (char *)ntdll_get_thread_data()->kernel_stack + kernel_stack_size;
 
     amd64_thread_data()->syscall_frame = (struct syscall_frame *)kernel_stack - 1;
@@ -3295,6 +3387,15 @@ void signal_init_process(void)
     if (sigaction( SIGSEGV, &sig_act, NULL ) == -1) goto error;
     if (sigaction( SIGILL, &sig_act, NULL ) == -1) goto error;
     if (sigaction( SIGBUS, &sig_act, NULL ) == -1) goto error;
+
+    if ((env = getenv( "WINE_SYSCALL_PROFILE" )) && atoi( env ))
+    {
+        syscall_flags |= SYSCALL_PROFILE;
+        atexit( dump_syscall_stats );
+        sig_act.sa_sigaction = usr2_handler;
+        if (sigaction( SIGUSR2, &sig_act, NULL ) == -1) goto error;
+    }
+
     install_bpf(&sig_act);
     return;
 
@@ -3525,6 +3626,8 @@ __ASM_GLOBAL_FUNC( __wine_syscall_dispatcher,
                    "1:\tmovq %r10,%rcx\n\t"
                    "subq $0x20,%rsp\n\t"
                    "movq (%rbx),%r10\n\t"          /* table->ServiceTable */
+                   "testl $16,%r14d\n\t"           /* SYSCALL_PROFILE */
+                   "jnz 6f\n\t"
                    "callq *(%r10,%rax,8)\n\t"
                    "leaq -0x98(%rbp),%rcx\n"
                    "2:\tmovl 0x94(%rcx),%edx\n\t"  /* frame->restore_flags */
@@ -3577,6 +3680,27 @@ __ASM_GLOBAL_FUNC( __wine_syscall_dispatcher,
                    __ASM_NAME("__wine_syscall_dispatcher_return") ":\n\t"
                    "movl 0xb0(%rcx),%r14d\n\t"     /* frame->syscall_flags */
                    "movq %rdx,%rax\n\t"
+                   "jmp 2b\n"
+                   /* profiled syscall, r12/r13/r15 are restored from the frame on return */
+                   "6:\tmovq %rax,%r12\n\t"       /* syscall number */
+                   "movq %rdx,%r13\n\t"
+                   "rdtsc\n\t"
+                   "shlq $32,%rdx\n\t"
+                   "orq %rax,%rdx\n\t"
+                   "movq %rdx,%r15\n\t"            /* start time */
+                   "movq %r13,%rdx\n\t"
+                   "callq *(%r10,%r12,8)\n\t"
+                   "movq %rax,%r13\n\t"            /* status */
+                   "rdtsc\n\t"
+                   "shlq $32,%rdx\n\t"
+                   "orq %rax,%rdx\n\t"
+                   "subq %r15,%rdx\n\t"
+                   "movq %rdx,%r8\n\t"             /* cycles */
+                   "movl %r12d,%edx\n\t"           /* id */
+                   "movq %rbx,%rcx\n\t"            /* table */
+                   "call " __ASM_NAME("update_syscall_stats") "\n\t"
+                   "movq %r13,%rax\n\t"
+                   "leaq -0x98(%rbp),%rcx\n\t"
                    "jmp 2b" )
 
 
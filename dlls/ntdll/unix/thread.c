@@ -1387,6 +1387,7 @@ void abort_thread( int status )
  */
 void abort_process( int status )
 {
+    dbg_flush();
     _exit( get_unix_exit_code( status ));
 }
 
@@ -36,12 +36,16 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/ioctl.h>
 #ifdef HAVE_SYS_SYSINFO_H
 # include <sys/sysinfo.h>
 #endif
 #ifdef HAVE_SYS_SYSCTL_H
 # include <sys/sysctl.h>
 #endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #ifdef HAVE_SYS_PARAM_H
 # include <sys/param.h>
 #endif
@@ -205,11 +209,83 @@ static BYTE *pages_vprot;
 #endif
 
 static BOOL use_kernel_writewatch;
-static int pagemap_fd, pagemap_reset_fd, clear_refs_fd;
+static int pagemap_fd = -1, pagemap_reset_fd = -1, clear_refs_fd = -1;
+static int uffd_fd = -1;  /* userfaultfd used with PAGEMAP_SCAN write watches */
 #define PAGE_FLAGS_BUFFER_LENGTH 1024
 #define PM_SOFT_DIRTY_PAGE (1ull << 57)
 
+#ifdef __linux__
+/* definitions from linux/userfaultfd.h and linux/fs.h, which may be missing or too old */
+#define UFFD_USER_MODE_ONLY          1
+#define UFFD_API_VERSION             0xaa
+#define UFFD_FEATURE_WP_UNPOPULATED  (1 << 13)
+#define UFFD_FEATURE_WP_ASYNC        (1 << 15)
+#define UFFD_REGISTER_MODE_WP        (1 << 1)
+#define UFFD_WRITEPROTECT_MODE_WP    (1 << 0)
+
+struct uffd_api
+{
+    UINT64 api;
+    UINT64 features;
+    UINT64 ioctls;
+};
+
+struct uffd_range
+{
+    UINT64 start;
+    UINT64 len;
+};
+
+struct uffd_register
+{
+    struct uffd_range range;
+    UINT64 mode;
+    UINT64 ioctls;
+};
+
+struct uffd_writeprotect
+{
+    struct uffd_range range;
+    UINT64 mode;
+};
+
+#define UFFD_IOC_API           _IOWR( 0xaa, 0x3f, struct uffd_api )
+#define UFFD_IOC_REGISTER      _IOWR( 0xaa, 0x00, struct uffd_register )
+#define UFFD_IOC_WRITEPROTECT  _IOWR( 0xaa, 0x06, struct uffd_writeprotect )
+
+#define PM_PAGE_IS_WRITTEN     (1 << 1)
+#define PM_SCAN_WP_MATCHING    (1 << 0)
+#define PM_SCAN_CHECK_WPASYNC  (1 << 1)
+
+struct pm_page_region
+{
+    UINT64 start;
+    UINT64 end;
+    UINT64 categories;
+};
+
+struct pm_scan
+{
+    UINT64 size;
+    UINT64 flags;
+    UINT64 start;
+    UINT64 end;
+    UINT64 walk_end;
+    UINT64 vec;
+    UINT64 vec_len;
+    UINT64 max_pages;
+    UINT64 category_inverted;
+    UINT64 category_mask;
+    UINT64 category_anyof_mask;
+    UINT64 return_mask;
+};
+
+#define PM_IOC_SCAN  _IOWR( 'f', 16, struct pm_scan )
+#endif
+
 static void reset_write_watches( void *base, SIZE_T size );
+static BOOL register_write_watches( void *base, SIZE_T size );
+static void disable_scan_write_watches(void);
 
 static struct file_view *view_block_start, *view_block_end, *next_free_view;
 #ifdef _WIN64
@@ -220,6 +296,8 @@ static const size_t view_block_size = 0x100000;
 static void *preload_reserve_start;
 static void *preload_reserve_end;
 static BOOL force_exec_prot;  /* whether to force PROT_EXEC on all PROT_READ mmaps */
+static const size_t large_page_size = 0x200000;  /* must match GetLargePageMinimum() */
+static size_t huge_page_threshold;  /* minimum size of private commits using huge pages, 0 if disabled */
 
 struct range_entry
 {
@@ -1220,6 +1298,7 @@ struct alloc_area
 {
     char *map_area_start, *map_area_end, *result;
     size_t size;
+    size_t align_mask;
     ptrdiff_t step;
     int unix_prot;
     BOOL top_down;
@@ -1481,7 +1560,10 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
     }
 
     if (vprot & VPROT_WRITEWATCH && use_kernel_writewatch)
+    {
+        if (!register_write_watches( view->base, view->size )) disable_scan_write_watches();
         reset_write_watches( view->base, view->size );
+    }
 
     return STATUS_SUCCESS;
 }
@@ -1658,6 +1740,169 @@ static void update_write_watches( void *base, size_t size, size_t accessed_size
 }
 
 
+/***********************************************************************
+ *           register_write_watches
+ *
+ * Register a newly mapped range with the userfaultfd, so that writes are tracked.
+ */
+static BOOL register_write_watches( void *base, SIZE_T size )
+{
+#ifdef __linux__
+    struct uffd_register reg;
+
+    if (uffd_fd == -1) return TRUE;
+    reg.range.start = (ULONG_PTR)base;
+    reg.range.len = size;
+    reg.mode = UFFD_REGISTER_MODE_WP;
+    if (ioctl( uffd_fd, UFFD_IOC_REGISTER, &reg ))
+    {
+        WARN( "Could not register %p-%p, error %s.\n", base, (char *)base + size, strerror(errno) );
+        return FALSE;
+    }
+#endif
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           disable_scan_write_watches
+ *
+ * Switch from userfaultfd write watches to the mprotect-based ones, after a range
+ * couldn't be registered. This is process-wide since page protections don't know
+ * which view they belong to; the pages of existing views are reported as written
+ * until their next reset.
+ * virtual_mutex must be held by caller.
+ */
+static void disable_scan_write_watches(void)
+{
+    struct file_view *view;
+
+    if (uffd_fd == -1) return;
+
+    ERR( "userfaultfd write watches failed, falling back to page protections\n" );
+    close( uffd_fd );
+    uffd_fd = -1;
+    close( pagemap_fd );
+    pagemap_fd = -1;
+    use_kernel_writewatch = FALSE;
+
+    WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
+    {
+        if (!(view->protect & VPROT_WRITEWATCH)) continue;
+        set_page_vprot_bits( view->base, view->size, 0, VPROT_WRITEWATCH );
+        mprotect_range( view->base, view->size, 0, 0 );
+    }
+}
+
+
+/***********************************************************************
+ *           get_scan_write_watches
+ *
+ * Retrieve the written pages of a range with PAGEMAP_SCAN, optionally resetting them.
+ */
+static NTSTATUS get_scan_write_watches( char *addr, char *end, BOOL reset, void **addresses, ULONG_PTR *count )
+{
+#ifdef __linux__
+    struct pm_page_region regions[64];
+    struct pm_scan scan;
+    ULONG_PTR pos = 0;
+    char *page;
+    int i, ret;
+
+    while (pos < *count && addr < end)
+    {
+        memset( &scan, 0, sizeof(scan) );
+        scan.size          = sizeof(scan);
+        scan.flags         = reset ? PM_SCAN_WP_MATCHING | PM_SCAN_CHECK_WPASYNC : 0;
+        scan.start         = (ULONG_PTR)addr;
+        scan.end           = (ULONG_PTR)end;
+        scan.vec           = (ULONG_PTR)regions;
+        scan.vec_len       = ARRAY_SIZE(regions);
+        scan.max_pages     = *count - pos;
+        scan.category_mask = PM_PAGE_IS_WRITTEN;
+        scan.return_mask   = PM_PAGE_IS_WRITTEN;
+
+        if ((ret = ioctl( pagemap_fd, PM_IOC_SCAN, &scan )) == -1)
+        {
+            ERR( "Error scanning page flags, error %s.\n", strerror(errno) );
+            return STATUS_INVALID_ADDRESS;
+        }
+        for (i = 0; i < ret; i++)
+            for (page = (char *)(ULONG_PTR)regions[i].start;
+                 page < (char *)(ULONG_PTR)regions[i].end && pos < *count; page += page_size)
+                addresses[pos++] = page;
+
+        if (scan.walk_end <= (ULONG_PTR)addr) break;
+        addr = (char *)(ULONG_PTR)scan.walk_end;
+    }
+    *count = pos;
+    return STATUS_SUCCESS;
+#else
+    return STATUS_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/***********************************************************************
+ *           init_scan_write_watches
+ *
+ * Check for userfaultfd asynchronous write-protection and the PAGEMAP_SCAN ioctl.
+ */
+static BOOL init_scan_write_watches(void)
+{
+#if defined(__linux__) && defined(__NR_userfaultfd)
+    struct uffd_api api;
+    struct pm_page_region region;
+    struct pm_scan scan;
+    BOOL ret = FALSE;
+    char *ptr;
+
+    if ((uffd_fd = syscall( __NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY )) == -1 &&
+        (uffd_fd = syscall( __NR_userfaultfd, O_CLOEXEC | O_NONBLOCK )) == -1)
+        return FALSE;
+
+    api.api = UFFD_API_VERSION;
+    api.features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+    api.ioctls = 0;
+    if (ioctl( uffd_fd, UFFD_IOC_API, &api )) goto done;
+    if ((pagemap_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC )) == -1) goto done;
+
+    /* make sure that a write to a registered page is reported */
+    if ((ptr = anon_mmap_alloc( page_size, PROT_READ | PROT_WRITE )) == MAP_FAILED) goto done;
+    if (!register_write_watches( ptr, page_size ))
+    {
+        munmap( ptr, page_size );
+        goto done;
+    }
+    reset_write_watches( ptr, page_size );
+    *ptr = 1;
+    memset( &scan, 0, sizeof(scan) );
+    scan.size          = sizeof(scan);
+    scan.start         = (ULONG_PTR)ptr;
+    scan.end           = (ULONG_PTR)ptr + page_size;
+    scan.vec           = (ULONG_PTR)&region;
+    scan.vec_len       = 1;
+    scan.category_mask = PM_PAGE_IS_WRITTEN;
+    scan.return_mask   = PM_PAGE_IS_WRITTEN;
+    ret = ioctl( pagemap_fd, PM_IOC_SCAN, &scan ) == 1;
+    munmap( ptr, page_size );
+
+done:
+    if (!ret)
+    {
+        close( uffd_fd );
+        uffd_fd = -1;
+        /* only this function opens pagemap_fd when userfaultfd is used */
+        if (pagemap_fd != -1) close( pagemap_fd );
+        pagemap_fd = -1;
+    }
+    return ret;
+#else
+    return FALSE;
+#endif
+}
+
+
 /***********************************************************************
  *           reset_write_watches
  *
@@ -1665,6 +1910,19 @@ static void update_write_watches( void *base, size_t size, size_t accessed_size
  */
 static void reset_write_watches( void *base, SIZE_T size )
 {
+#ifdef __linux__
+    if (uffd_fd != -1)
+    {
+        struct uffd_writeprotect wp;
+
+        wp.range.start = (ULONG_PTR)base;
+        wp.range.len = size;
+        wp.mode = UFFD_WRITEPROTECT_MODE_WP;
+        if (ioctl( uffd_fd, UFFD_IOC_WRITEPROTECT, &wp ))
+            ERR( "Could not write-protect %p-%p, error %s.\n", base, (char *)base + size, strerror(errno) );
+        return;
+    }
+#endif
     if (use_kernel_writewatch)
     {
         char buffer[17];
@@ -1730,15 +1988,15 @@ static int alloc_area_in_reserved_or_between_callback( void *start, SIZE_T size,
 
         if (area->map_area_end - intersect_end >= area->size)
         {
-            alloc_start = ROUND_ADDR( (char *)area->map_area_end - size, granularity_mask );
+            alloc_start = ROUND_ADDR( (char *)area->map_area_end - size, area->align_mask );
             if ((area->result = try_map_free_area( area, intersect_end,
                     alloc_start + size, alloc_start )))
                 return 1;
         }
 
-        if (intersect_end - intersect_start >= area->size)
+        alloc_start = ROUND_ADDR( intersect_end - area->size, area->align_mask );
+        if (intersect_end - intersect_start >= area->size && alloc_start >= intersect_start)
         {
-            alloc_start = ROUND_ADDR( intersect_end - area->size, granularity_mask );
             if ((area->result = anon_mmap_fixed( alloc_start, area->size,
                     area->unix_prot, 0 )) != alloc_start)
                 ERR("Could not map in reserved area, alloc_start %p, size %p.\n",
@@ -1765,17 +2023,20 @@ static int alloc_area_in_reserved_or_between_callback( void *start, SIZE_T size,
         assert(ROUND_ADDR(intersect_end + granularity_mask, granularity_mask) == intersect_end);
         assert(ROUND_ADDR(area->map_area_start, granularity_mask) == area->map_area_start);
 
+        alloc_start = ROUND_ADDR( area->map_area_start + area->align_mask, area->align_mask );
         if (intersect_start - area->map_area_start >= area->size)
         {
             if ((area->result = try_map_free_area( area, area->map_area_start,
-                    intersect_start, area->map_area_start )))
+                    intersect_start, alloc_start )))
                 return 1;
         }
 
-        if (intersect_end - intersect_start >= area->size)
+        alloc_start = ROUND_ADDR( intersect_start + area->align_mask, area->align_mask );
+        if (intersect_end - intersect_start >= area->size && alloc_start < intersect_end &&
+            intersect_end - alloc_start >= area->size)
         {
-            if ((area->result = anon_mmap_fixed( intersect_start, area->size, area->unix_prot, 0 ))
-                    != intersect_start)
+            if ((area->result = anon_mmap_fixed( alloc_start, area->size, area->unix_prot, 0 ))
+                    != alloc_start)
                 ERR("Could not map in reserved area.\n");
             return 1;
         }
@@ -1801,13 +2062,13 @@ static void *alloc_free_area_in_range( struct alloc_area *area, char *base, char
 
     if (area->top_down)
     {
-        start = ROUND_ADDR( end - area->size, granularity_mask );
+        start = ROUND_ADDR( end - area->size, area->align_mask );
         if (start >= end || start < base)
             return NULL;
     }
     else
     {
-        start = ROUND_ADDR( base + granularity_mask, granularity_mask );
+        start = ROUND_ADDR( base + area->align_mask, area->align_mask );
         if (!start || start >= end || (char *)end - (char *)start < area->size)
             return NULL;
     }
@@ -1819,7 +2080,7 @@ static void *alloc_free_area_in_range( struct alloc_area *area, char *base, char
 
     if (area->top_down)
     {
-        start = ROUND_ADDR( area->map_area_end - area->size, granularity_mask );
+        start = ROUND_ADDR( area->map_area_end - area->size, area->align_mask );
         if (start >= area->map_area_end || start < area->map_area_start)
             return NULL;
 
@@ -1827,7 +2088,7 @@ static void *alloc_free_area_in_range( struct alloc_area *area, char *base, char
     }
     else
     {
-        start = ROUND_ADDR( area->map_area_start + granularity_mask, granularity_mask );
+        start = ROUND_ADDR( area->map_area_start + area->align_mask, area->align_mask );
         if (!start || start >= area->map_area_end
                 || area->map_area_end - start < area->size)
             return NULL;
@@ -1836,7 +2097,7 @@ static void *alloc_free_area_in_range( struct alloc_area *area, char *base, char
     }
 }
 
-static void *alloc_free_area( void *limit, size_t size, BOOL top_down, int unix_prot )
+static void *alloc_free_area( void *limit, size_t size, BOOL top_down, int unix_prot, size_t align_mask )
 {
     struct range_entry *range, *ranges_start, *ranges_end;
     char *reserve_start, *reserve_end;
@@ -1845,7 +2106,7 @@ static void *alloc_free_area( void *limit, size_t size, BOOL top_down, int unix_
     NTSTATUS status;
     int ranges_inc;
 
-    TRACE("limit %p, size %p, top_down %#x.\n", limit, (void *)size, top_down);
+    TRACE("limit %p, size %p, top_down %#x, align_mask %p.\n", limit, (void *)size, top_down, (void *)align_mask);
 
     if (top_down)
     {
@@ -1861,8 +2122,9 @@ static void *alloc_free_area( void *limit, size_t size, BOOL top_down, int unix_
     }
 
     memset( &area, 0, sizeof(area) );
-    area.step = top_down ? -(granularity_mask + 1) : (granularity_mask + 1);
+    area.step = top_down ? -(align_mask + 1) : (align_mask + 1);
     area.size = size;
+    area.align_mask = align_mask;
     area.top_down = top_down;
     area.unix_prot = unix_prot;
 
@@ -2030,7 +2292,7 @@ static void clear_native_views(void)
  * virtual_mutex must be held by caller.
  */
 static NTSTATUS map_view( struct file_view **view_ret, void *base, size_t size,
-                          int top_down, unsigned int vprot, ULONG_PTR zero_bits )
+                          int top_down, unsigned int vprot, ULONG_PTR zero_bits, size_t align_mask )
 {
     void *ptr;
     NTSTATUS status;
@@ -2044,13 +2306,13 @@ static NTSTATUS map_view( struct file_view **view_ret, void *base, size_t size,
         ptr = base;
     }
     else if (!(ptr = alloc_free_area( (void*)(get_zero_bits_mask( zero_bits )
-            & (UINT_PTR)user_space_limit), size, top_down, get_unix_prot( vprot ) )))
+            & (UINT_PTR)user_space_limit), size, top_down, get_unix_prot( vprot ), align_mask )))
     {
         WARN("Allocation failed, clearing native views.\n");
 
         clear_native_views();
         if (!(ptr = alloc_free_area( (void*)(get_zero_bits_mask( zero_bits )
-                & (UINT_PTR)user_space_limit), size, top_down, get_unix_prot( vprot ) )))
+                & (UINT_PTR)user_space_limit), size, top_down, get_unix_prot( vprot ), align_mask )))
             return STATUS_NO_MEMORY;
     }
     status = create_view( view_ret, ptr, size, vprot );
@@ -2182,6 +2444,12 @@ static NTSTATUS decommit_pages( struct file_view *view, size_t start, size_t siz
     if (anon_mmap_fixed( (char *)view->base + start, size, PROT_NONE, 0 ) != MAP_FAILED)
     {
         set_page_vprot_bits( (char *)view->base + start, size, 0, VPROT_COMMITTED );
+        /* the new mapping is no longer registered */
+        if (uffd_fd != -1 && (view->protect & VPROT_WRITEWATCH))
+        {
+            if (!register_write_watches( (char *)view->base + start, size )) disable_scan_write_watches();
+            reset_write_watches( (char *)view->base + start, size );
+        }
         return STATUS_SUCCESS;
     }
     return STATUS_NO_MEMORY;
@@ -2210,7 +2478,7 @@ static NTSTATUS allocate_dos_memory( struct file_view **view, unsigned int vprot
     if (mmap_is_in_reserved_area( low_64k, dosmem_size - 0x10000 ) != 1)
     {
         addr = anon_mmap_tryfixed( low_64k, dosmem_size - 0x10000, unix_prot, 0 );
-        if (addr == MAP_FAILED) return map_view( view, NULL, dosmem_size, FALSE, vprot, 0 );
+        if (addr == MAP_FAILED) return map_view( view, NULL, dosmem_size, FALSE, vprot, 0, granularity_mask );
     }
 
     /* now try to allocate the low 64K too */
@@ -2554,9 +2822,9 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     if ((ULONG_PTR)base != image_info->base) base = NULL;
 
     if ((char *)base >= (char *)address_space_start)  /* make sure the DOS area remains free */
-        status = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits );
+        status = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits, granularity_mask );
 
-    if (status) status = map_view( &view, NULL, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits );
+    if (status) status = map_view( &view, NULL, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits, granularity_mask );
     if (status) goto done;
 
     status = map_image_into_view( view, filename, unix_fd, base, image_info->header_size,
@@ -2679,7 +2947,7 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_PTR z
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
-    res = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits );
+    res = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits, granularity_mask );
     if (res) goto done;
 
     TRACE( "handle=%p size=%lx offset=%x%08x\n", handle, size, offset.u.HighPart, offset.u.LowPart );
@@ -2762,22 +3030,36 @@ void virtual_init(void)
     pthread_mutex_init( &virtual_mutex, &attr );
     pthread_mutexattr_destroy( &attr );
 
-    if (!((env_var = getenv("WINE_DISABLE_KERNEL_WRITEWATCH")) && atoi(env_var))
-            && (pagemap_reset_fd = open("/proc/self/pagemap_reset", O_RDONLY)) != -1)
+    if (!((env_var = getenv("WINE_DISABLE_KERNEL_WRITEWATCH")) && atoi(env_var)))
     {
-        use_kernel_writewatch = TRUE;
-        if ((pagemap_fd = open("/proc/self/pagemap", O_RDONLY)) == -1)
+        if ((pagemap_reset_fd = open("/proc/self/pagemap_reset", O_RDONLY)) != -1)
         {
-            ERR("Could not open pagemap file, error %s.\n", strerror(errno));
-            exit(-1);
+            use_kernel_writewatch = TRUE;
+            if ((pagemap_fd = open("/proc/self/pagemap", O_RDONLY)) == -1)
+            {
+                ERR("Could not open pagemap file, error %s.\n", strerror(errno));
+                exit(-1);
+            }
+            if ((clear_refs_fd = open("/proc/self/clear_refs", O_WRONLY)) == -1)
+            {
+                ERR("Could not open clear_refs file, error %s.\n", strerror(errno));
+                exit(-1);
+            }
+            if (ERR_ON(virtual))
+                MESSAGE("wine: using kernel write watches (experimental).\n");
         }
-        if ((clear_refs_fd = open("/proc/self/clear_refs", O_WRONLY)) == -1)
+        else if (init_scan_write_watches())
         {
-            ERR("Could not open clear_refs file, error %s.\n", strerror(errno));
-            exit(-1);
+            use_kernel_writewatch = TRUE;
+            TRACE("using userfaultfd and PAGEMAP_SCAN for write watches\n");
         }
-        if (ERR_ON(virtual))
-            MESSAGE("wine: using kernel write watches (experimental).\n");
+    }
+
+    /* size in MB above which private allocations use transparent huge pages */
+    if ((env_var = getenv("WINE_HUGEPAGE_THRESHOLD")) && atoi(env_var) > 0)
+    {
+        huge_page_threshold = max( (size_t)atoi(env_var) << 20, large_page_size );
+        TRACE( "using huge pages for allocations larger than %lx\n", (unsigned long)huge_page_threshold );
     }
 
     if (preload_info && *preload_info)
@@ -3239,7 +3521,8 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
     if ((status = map_view( &view, NULL, size + extra_size, FALSE,
-                            VPROT_READ | VPROT_WRITE | VPROT_COMMITTED, zero_bits )) != STATUS_SUCCESS)
+                            VPROT_READ | VPROT_WRITE | VPROT_COMMITTED, zero_bits,
+                            granularity_mask )) != STATUS_SUCCESS)
         goto done;
 
 #ifdef VALGRIND_STACK_REGISTER
@@ -3871,6 +4154,42 @@ void virtual_set_large_address_space(void)
 }
 
 
+/***********************************************************************
+ *           set_huge_pages
+ *
+ * Ask the kernel to back an anonymous range with transparent huge pages.
+ * Only the 2Mb-aligned parts of the range can actually use them.
+ */
+static void set_huge_pages( void *base, size_t size )
+{
+#ifdef MADV_HUGEPAGE
+    if (madvise( base, size, MADV_HUGEPAGE ))
+        WARN( "madvise %p-%p failed: %s\n", base, (char *)base + size - 1, strerror(errno) );
+#endif
+}
+
+
+/***********************************************************************
+ *           set_numa_node
+ *
+ * Set the preferred NUMA node of a range that hasn't been touched yet.
+ */
+static void set_numa_node( void *base, size_t size, ULONG node )
+{
+#if defined(__linux__) && defined(__NR_mbind)
+    unsigned long mask[4] = { 0 };
+    const unsigned int bits = sizeof(mask[0]) * 8;
+
+    if (node >= ARRAY_SIZE(mask) * bits) return;
+    mask[node / bits] = 1ul << (node % bits);
+    if (syscall( __NR_mbind, base, size, 1 /* MPOL_PREFERRED */, mask, ARRAY_SIZE(mask) * bits, 0 ))
+        WARN( "mbind %p-%p node %u failed: %s\n", base, (char *)base + size - 1, node, strerror(errno) );
+#else
+    FIXME( "Ignoring preferred node %u\n", node );
+#endif
+}
+
+
 /***********************************************************************
  *             NtAllocateVirtualMemory   (NTDLL.@)
  *             ZwAllocateVirtualMemory   (NTDLL.@)
@@ -3966,12 +4285,21 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
     /* Compute the alloc type flags */
 
     if (!(type & (MEM_COMMIT | MEM_RESERVE | MEM_RESET)) ||
-        (type & ~(MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET)))
+        (type & ~(MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET | MEM_LARGE_PAGES)))
     {
         WARN("called with wrong alloc type flags (%08x) !\n", type);
         return STATUS_INVALID_PARAMETER;
     }
 
+    /* large pages must be reserved and committed at once, in multiples of the large page size */
+    if ((type & MEM_LARGE_PAGES) &&
+        ((type & (MEM_COMMIT | MEM_RESERVE)) != (MEM_COMMIT | MEM_RESERVE) ||
+         (size & (large_page_size - 1)) || ((UINT_PTR)base & (large_page_size - 1))))
+    {
+        WARN("invalid large page allocation %p-%p type %08x\n", base, (char *)base + size, type);
+        return STATUS_INVALID_PARAMETER;
+    }
+
     /* Reserve the memory */
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
@@ -3986,9 +4314,16 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
 
             if (vprot & VPROT_WRITECOPY) status = STATUS_INVALID_PAGE_PROTECTION;
             else if (is_dos_memory) status = allocate_dos_memory( &view, vprot );
-            else status = map_view( &view, base, size, type & MEM_TOP_DOWN, vprot, zero_bits );
+            else status = map_view( &view, base, size, type & MEM_TOP_DOWN, vprot, zero_bits,
+                                    (type & MEM_LARGE_PAGES) ? large_page_size - 1 : granularity_mask );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                base = view->base;
+                if ((type & MEM_LARGE_PAGES) ||
+                    (huge_page_threshold && (type & MEM_COMMIT) && size >= huge_page_threshold))
+                    set_huge_pages( base, size );
+            }
         }
     }
     else if (type & MEM_RESET)
@@ -4011,6 +4346,8 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
             }
             SERVER_END_REQ;
         }
+        else if (!status && huge_page_threshold && size >= huge_page_threshold && is_view_valloc( view ))
+            set_huge_pages( base, size );
     }
 
     if (!status) VIRTUAL_DEBUG_DUMP_VIEW( view );
@@ -4033,11 +4370,34 @@ NTSTATUS WINAPI NtAllocateVirtualMemoryEx( HANDLE process, PVOID *ret, SIZE_T *s
                                            ULONG protect, MEM_EXTENDED_PARAMETER *parameters,
                                            ULONG count )
 {
+    ULONG i, node = ~0u;
+    NTSTATUS status;
+
     if (count && !parameters) return STATUS_INVALID_PARAMETER;
 
-    if (count) FIXME( "Ignoring %d extended parameters %p\n", count, parameters );
+    for (i = 0; i < count; i++)
+    {
+        switch (parameters[i].Type)
+        {
+        case MemExtendedParameterNumaNode:
+            node = parameters[i].ULong;
+            break;
+        default:
+            FIXME( "Ignoring extended parameter type %u\n", (int)parameters[i].Type );
+            break;
+        }
+    }
+
+    status = NtAllocateVirtualMemory( process, ret, 0, size_ptr, type, protect );
 
-    return NtAllocateVirtualMemory( process, ret, 0, size_ptr, type, protect );
+    /* the memory policy sticks to the mapping, so setting it on a reservation also
+     * covers later commits; it is lost if the range is decommitted and committed again */
+    if (!status && node != ~0u)
+    {
+        if (process != NtCurrentProcess()) FIXME( "Ignoring preferred node %u for process %p\n", node, process );
+        else if (type & (MEM_COMMIT | MEM_RESERVE)) set_numa_node( *ret, *size_ptr, node );
+    }
+    return status;
 }
 
 
@@ -5033,6 +5393,12 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
         char *addr = base;
         char *end = addr + size;
 
+        if (uffd_fd != -1)
+        {
+            status = get_scan_write_watches( addr, end, flags & WRITE_WATCH_FLAG_RESET, addresses, count );
+            *granularity = page_size;
+            goto done;
+        }
         if (use_kernel_writewatch)
         {
             static UINT64 buffer[PAGE_FLAGS_BUFFER_LENGTH];
@@ -345,6 +345,36 @@ static HRESULT SAFEARRAY_DestroyData(SAFEARRAY *psa, ULONG ulStartCell)
   return S_OK;
 }
 
+/* Whether a variant holds no resources and can be copied or overwritten as is */
+static inline BOOL SAFEARRAY_IsPlainVariant(const VARIANT *var)
+{
+  switch (V_VT(var))
+  {
+  case VT_EMPTY:
+  case VT_NULL:
+  case VT_I1:
+  case VT_I2:
+  case VT_I4:
+  case VT_I8:
+  case VT_UI1:
+  case VT_UI2:
+  case VT_UI4:
+  case VT_UI8:
+  case VT_INT:
+  case VT_UINT:
+  case VT_R4:
+  case VT_R8:
+  case VT_CY:
+  case VT_DATE:
+  case VT_BOOL:
+  case VT_ERROR:
+  case VT_DECIMAL:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
 /* Copy data items from one array to another. Destination data is freed before copy. */
 static HRESULT SAFEARRAY_CopyData(SAFEARRAY *psa, SAFEARRAY *dest)
 {
@@ -370,6 +400,12 @@ static HRESULT SAFEARRAY_CopyData(SAFEARRAY *psa, SAFEARRAY *dest)
       {
         HRESULT hRet;
 
+        if (SAFEARRAY_IsPlainVariant(src_var) && SAFEARRAY_IsPlainVariant(dest_var))
+        {
+          *dest_var++ = *src_var++;
+          continue;
+        }
+
         /* destination is cleared automatically */
         hRet = VariantCopy(dest_var, src_var);
         if (FAILED(hRet)) FIXME("VariantCopy failed with 0x%08x, element %u\n", hRet, ulCellCount);
@@ -831,11 +831,13 @@ static void test_TypeInfo(void)
     static WCHAR wszBogus[] = { 'b','o','g','u','s',0 };
     static WCHAR wszGetTypeInfo[] = { 'G','e','t','T','y','p','e','I','n','f','o',0 };
     static WCHAR wszClone[] = {'C','l','o','n','e',0};
+    static WCHAR wszclone[] = {'c','L','O','N','E',0};
     static WCHAR wszTestDll[] = {'t','e','s','t','.','d','l','l',0};
     OLECHAR* bogus = wszBogus;
     OLECHAR* pwszGetTypeInfo = wszGetTypeInfo;
     OLECHAR* pwszClone = wszClone;
-    DISPID dispidMember;
+    OLECHAR* pwszclone = wszclone;
+    DISPID dispidMember, dispid;
     DISPPARAMS dispparams;
     GUID bogusguid = {0x806afb4f,0x13f7,0x42d2,{0x89,0x2c,0x6c,0x97,0xc3,0x6a,0x36,0xc1}};
     static const GUID moduleTestGetDllEntryGuid = {0xf073cd92,0xa199,0x11ea,{0xbb,0x37,0x02,0x42,0xac,0x13,0x00,0x02}};
@@ -908,6 +910,14 @@ static void test_TypeInfo(void)
     hr = ITypeInfo_GetIDsOfNames(pTypeInfo, &pwszClone, 1, &dispidMember);
     ok_ole_success(hr, ITypeInfo_GetIDsOfNames);
 
+    /* names are case insensitive, repeated lookups give the same results */
+    hr = ITypeInfo_GetIDsOfNames(pTypeInfo, &pwszclone, 1, &dispid);
+    ok_ole_success(hr, ITypeInfo_GetIDsOfNames);
+    ok(dispid == dispidMember, "got dispid %d, expected %d\n", dispid, dispidMember);
+    hr = ITypeInfo_GetIDsOfNames(pTypeInfo, &bogus, 1, &dispid);
+    ok(hr == DISP_E_UNKNOWNNAME, "got 0x%08x\n", hr);
+    ok(dispid == MEMBERID_NIL, "got dispid %d\n", dispid);
+
     /* correct member id -- wrong flags -- cNamedArgs not bigger than cArgs */
     dispparams.cNamedArgs = 0;
     hr = ITypeInfo_Invoke(pTypeInfo, (void *)0xdeadbeef, dispidMember, DISPATCH_PROPERTYGET, &dispparams, NULL, NULL, NULL);
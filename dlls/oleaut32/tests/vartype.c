@@ -5904,6 +5904,35 @@ static void test_ChangeType_keep_dst(void)
      SysFreeString(bstr);
 }
 
+static void test_ChangeType_in_place(void)
+{
+    static const LCID lcid_de = MAKELCID(MAKELANGID(LANG_GERMAN, SUBLANG_GERMAN), SORT_DEFAULT);
+    static const LCID lcid_en = MAKELCID(MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US), SORT_DEFAULT);
+    VARIANT v;
+    HRESULT hres;
+    int i;
+
+    /* Alternate locales, the number characters must follow the lcid */
+    for (i = 0; i < 4; i++)
+    {
+        V_VT(&v) = VT_BSTR;
+        V_BSTR(&v) = SysAllocString(L"1,5");
+        hres = VariantChangeTypeEx(&v, &v, i & 1 ? lcid_en : lcid_de, VARIANT_NOUSEROVERRIDE, VT_R8);
+        ok(hres == S_OK, "%d: VariantChangeTypeEx returns %08x\n", i, hres);
+        ok(V_VT(&v) == VT_R8, "%d: got vt %d\n", i, V_VT(&v));
+        ok(V_R8(&v) == (i & 1 ? 15.0 : 1.5), "%d: got %f\n", i, V_R8(&v));
+    }
+
+    V_VT(&v) = VT_I4;
+    V_I4(&v) = 42;
+    hres = VariantChangeTypeEx(&v, &v, lcid_en, 0, VT_BSTR);
+    ok(hres == S_OK, "VariantChangeTypeEx returns %08x\n", hres);
+    ok(V_VT(&v) == VT_BSTR && !lstrcmpW(V_BSTR(&v), L"42"), "got vt %d\n", V_VT(&v));
+    hres = VariantChangeTypeEx(&v, &v, lcid_en, 0, VT_I2);
+    ok(hres == S_OK, "VariantChangeTypeEx returns %08x\n", hres);
+    ok(V_VT(&v) == VT_I2 && V_I2(&v) == 42, "got vt %d\n", V_VT(&v));
+}
+
 /* This tests assumes an empty cache, so it needs to be ran early in the test. */
 static void test_bstr_cache(void)
 {
@@ -6422,6 +6451,7 @@ START_TEST(vartype)
 
   test_NullByRef();
   test_ChangeType_keep_dst();
+  test_ChangeType_in_place();
 
   test_recinfo();
 }
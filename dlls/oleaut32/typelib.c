@@ -1172,6 +1172,20 @@ typedef struct tagTLBParDesc
     struct list custdata_list;
 } TLBParDesc;
 
+/* argument and return types of a function as resolved by ITypeInfo::Invoke */
+typedef struct tagTLBInvokeParam
+{
+    VARTYPE vt;
+    BOOL has_iid;           /* iid of a VT_USERDEFINED interface argument is known */
+    GUID iid;
+} TLBInvokeParam;
+
+typedef struct tagTLBInvokePlan
+{
+    VARTYPE ret_vt;
+    TLBInvokeParam params[1];
+} TLBInvokePlan;
+
 /* internal Function data */
 typedef struct tagTLBFuncDesc
 {
@@ -1183,6 +1197,7 @@ typedef struct tagTLBFuncDesc
     const TLBString *HelpString;
     const TLBString *Entry;            /* if IS_INTRESOURCE true, it's numeric; if -1 it isn't present */
     struct list custdata_list;
+    TLBInvokePlan *invoke_plan;        /* built on first invocation */
 } TLBFuncDesc;
 
 /* internal Variable data */
@@ -1197,6 +1212,20 @@ typedef struct tagTLBVarDesc
     struct list custdata_list;
 } TLBVarDesc;
 
+/* hash of the function and variable names of a type info, used by GetIDsOfNames */
+typedef struct tagTLBNameHashEntry
+{
+    ULONG hash;
+    UINT index;             /* function index, or cFuncs + variable index */
+} TLBNameHashEntry;
+
+typedef struct tagTLBNameHash
+{
+    BOOL complete;          /* all member names are plain identifiers */
+    UINT mask;
+    TLBNameHashEntry entries[1];
+} TLBNameHash;
+
 /* internal implemented interface data */
 typedef struct tagTLBImplType
 {
@@ -1243,6 +1272,8 @@ typedef struct tagITypeInfoImpl
 
     struct list *pcustdata_list;
     struct list custdata_list;
+
+    TLBNameHash *name_hash;     /* built on first GetIDsOfNames call */
 } ITypeInfoImpl;
 
 static inline ITypeInfoImpl *info_impl_from_ITypeComp( ITypeComp *iface )
@@ -5602,6 +5633,21 @@ static void typeinfo_release_funcdesc(TLBFuncDesc *func)
     heap_free(func->funcdesc.lprgelemdescParam);
     heap_free(func->pParamDesc);
     TLB_FreeCustData(&func->custdata_list);
+    heap_free(func->invoke_plan);
+}
+
+/* drop the lookup data derived from the functions and variables, they have changed */
+static void typeinfo_invalidate_caches(ITypeInfoImpl *This)
+{
+    UINT i;
+
+    for (i = 0; i < This->typeattr.cFuncs; ++i)
+    {
+        heap_free(This->funcdescs[i].invoke_plan);
+        This->funcdescs[i].invoke_plan = NULL;
+    }
+    heap_free(This->name_hash);
+    This->name_hash = NULL;
 }
 
 static void ITypeInfoImpl_Destroy(ITypeInfoImpl *This)
@@ -5638,6 +5684,7 @@ static void ITypeInfoImpl_Destroy(ITypeInfoImpl *This)
     }
 
     TLB_FreeCustData(&This->custdata_list);
+    heap_free(This->name_hash);
 
     heap_free(This);
 }
@@ -5656,7 +5703,10 @@ static ULONG WINAPI ITypeInfo_fnRelease(ITypeInfo2 *iface)
         BOOL not_attached_to_typelib = This->not_attached_to_typelib;
         ITypeLib2_Release(&This->pTypeLib->ITypeLib2_iface);
         if (not_attached_to_typelib)
+        {
+            heap_free(This->name_hash);
             heap_free(This);
+        }
         /* otherwise This will be freed when typelib is freed */
     }
 
@@ -6279,6 +6329,127 @@ static HRESULT WINAPI ITypeInfo_fnGetImplTypeFlags( ITypeInfo2 *iface,
     return S_OK;
 }
 
+/* Hash a member name made only of ASCII letters, digits and underscores,
+ * case insensitively. Such names compare equal with lstrcmpiW only if they
+ * are equal ignoring ASCII case. */
+static BOOL TLB_hash_identifier(const WCHAR *name, ULONG *hash)
+{
+    ULONG h = 0;
+
+    if (!name || !*name)
+        return FALSE;
+
+    for (; *name; name++)
+    {
+        WCHAR c = *name;
+
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        else if (!(c >= 'A' && c <= 'Z') && !(c >= '0' && c <= '9') && c != '_')
+            return FALSE;
+        h = h * 31 + c;
+    }
+
+    *hash = h;
+    return TRUE;
+}
+
+static const WCHAR *typeinfo_get_member_name(const ITypeInfoImpl *This, UINT index)
+{
+    if (index < This->typeattr.cFuncs)
+        return TLB_get_bstr(This->funcdescs[index].Name);
+    return TLB_get_bstr(This->vardescs[index - This->typeattr.cFuncs].Name);
+}
+
+static TLBNameHash *typeinfo_build_name_hash(ITypeInfoImpl *This)
+{
+    UINT count = This->typeattr.cFuncs + This->typeattr.cVars, size = 8, index;
+    TLBNameHash *hash;
+
+    while (size < count * 2)
+        size <<= 1;
+
+    if (!(hash = heap_alloc(FIELD_OFFSET(TLBNameHash, entries[size]))))
+        return NULL;
+    hash->complete = TRUE;
+    hash->mask = size - 1;
+    for (index = 0; index < size; index++)
+        hash->entries[index].index = ~0u;
+
+    /* functions take precedence over variables, and the first member with
+     * a given name over later ones */
+    for (index = 0; index < count; index++)
+    {
+        const WCHAR *name = typeinfo_get_member_name(This, index);
+        TLBNameHashEntry *entry;
+        ULONG h;
+
+        if (!name)
+            continue;
+        if (!TLB_hash_identifier(name, &h))
+        {
+            hash->complete = FALSE;
+            continue;
+        }
+
+        for (entry = &hash->entries[h & hash->mask]; entry->index != ~0u;
+             entry = &hash->entries[(entry - hash->entries + 1) & hash->mask])
+        {
+            if (entry->hash == h && !wcsicmp(typeinfo_get_member_name(This, entry->index), name))
+                break;
+        }
+        if (entry->index != ~0u)
+            continue;
+
+        entry->hash = h;
+        entry->index = index;
+    }
+
+    return hash;
+}
+
+/* Look up a member by name in the hash. Returns FALSE if the linear search
+ * must be used instead, otherwise *index is the member index or ~0u if there
+ * is no member with that name. */
+static BOOL typeinfo_lookup_name(ITypeInfoImpl *This, const WCHAR *name, UINT *index)
+{
+    TLBNameHash *hash;
+    TLBNameHashEntry *entry;
+    ULONG h;
+
+    if (!TLB_hash_identifier(name, &h))
+        return FALSE;
+
+    if (!(hash = This->name_hash))
+    {
+        if (!(hash = typeinfo_build_name_hash(This)))
+            return FALSE;
+        if (InterlockedCompareExchangePointer((void **)&This->name_hash, hash, NULL))
+        {
+            heap_free(hash);
+            hash = This->name_hash;
+        }
+    }
+
+    for (entry = &hash->entries[h & hash->mask]; entry->index != ~0u;
+         entry = &hash->entries[(entry - hash->entries + 1) & hash->mask])
+    {
+        if (entry->hash == h && !wcsicmp(typeinfo_get_member_name(This, entry->index), name))
+        {
+            /* the locale may still treat case differently */
+            if (lstrcmpiW(name, typeinfo_get_member_name(This, entry->index)))
+                return FALSE;
+            *index = entry->index;
+            return TRUE;
+        }
+    }
+
+    if (!hash->complete)
+        return FALSE;
+    *index = ~0u;
+    return TRUE;
+}
+
 /* GetIDsOfNames
  * Maps between member names and member IDs, and parameter names and
  * parameter IDs.
@@ -6298,26 +6469,36 @@ static HRESULT WINAPI ITypeInfo_fnGetIDsOfNames( ITypeInfo2 *iface,
     for (i = 0; i < cNames; i++)
         pMemId[i] = MEMBERID_NIL;
 
-    for (fdc = 0; fdc < This->typeattr.cFuncs; ++fdc) {
+    if (!typeinfo_lookup_name(This, *rgszNames, &fdc))
+    {
+        for (fdc = 0; fdc < This->typeattr.cFuncs; ++fdc)
+            if (!lstrcmpiW(*rgszNames, TLB_get_bstr(This->funcdescs[fdc].Name)))
+                break;
+        if (fdc == This->typeattr.cFuncs)
+        {
+            pVDesc = TLB_get_vardesc_by_name(This, *rgszNames);
+            fdc = pVDesc ? This->typeattr.cFuncs + (pVDesc - This->vardescs) : ~0u;
+        }
+    }
+
+    if (fdc < This->typeattr.cFuncs) {
         int j;
         const TLBFuncDesc *pFDesc = &This->funcdescs[fdc];
-        if(!lstrcmpiW(*rgszNames, TLB_get_bstr(pFDesc->Name))) {
-            if(cNames) *pMemId=pFDesc->funcdesc.memid;
-            for(i=1; i < cNames; i++){
-                for(j=0; j<pFDesc->funcdesc.cParams; j++)
-                    if(!lstrcmpiW(rgszNames[i],TLB_get_bstr(pFDesc->pParamDesc[j].Name)))
-                            break;
-                if( j<pFDesc->funcdesc.cParams)
-                    pMemId[i]=j;
-                else
-                   ret=DISP_E_UNKNOWNNAME;
-            };
-            TRACE("-- 0x%08x\n", ret);
-            return ret;
-        }
+        if(cNames) *pMemId=pFDesc->funcdesc.memid;
+        for(i=1; i < cNames; i++){
+            for(j=0; j<pFDesc->funcdesc.cParams; j++)
+                if(!lstrcmpiW(rgszNames[i],TLB_get_bstr(pFDesc->pParamDesc[j].Name)))
+                        break;
+            if( j<pFDesc->funcdesc.cParams)
+                pMemId[i]=j;
+            else
+               ret=DISP_E_UNKNOWNNAME;
+        };
+        TRACE("-- 0x%08x\n", ret);
+        return ret;
     }
-    pVDesc = TLB_get_vardesc_by_name(This, *rgszNames);
-    if(pVDesc){
+    if (fdc != ~0u) {
+        pVDesc = &This->vardescs[fdc - This->typeattr.cFuncs];
         if(cNames)
             *pMemId = pVDesc->vardesc.memid;
         return ret;
@@ -7196,6 +7377,68 @@ static inline BOOL func_restricted( const FUNCDESC *desc )
     return (desc->wFuncFlags & FUNCFLAG_FRESTRICTED) && (desc->memid >= 0);
 }
 
+/* Resolving the argument types goes through the referenced type infos for
+ * every VT_USERDEFINED type, so it is done once per function. Returns NULL if
+ * the types can't be resolved, the caller then resolves them itself. */
+static const TLBInvokePlan *typeinfo_get_invoke_plan(ITypeInfoImpl *This, TLBFuncDesc *func)
+{
+    ITypeInfo *tinfo = (ITypeInfo *)&This->ITypeInfo2_iface;
+    const FUNCDESC *func_desc = &func->funcdesc;
+    TLBInvokePlan *plan;
+    int i;
+
+    if ((plan = func->invoke_plan))
+        return plan;
+
+    /* the referenced types may still change */
+    if (This->needs_layout)
+        return NULL;
+
+    if (!(plan = heap_alloc(FIELD_OFFSET(TLBInvokePlan, params[func_desc->cParams]))))
+        return NULL;
+
+    for (i = 0; i < func_desc->cParams; i++)
+    {
+        const TYPEDESC *tdesc = &func_desc->lprgelemdescParam[i].tdesc;
+        TLBInvokeParam *param = &plan->params[i];
+
+        param->vt = 0;
+        param->has_iid = FALSE;
+        if (FAILED(typedescvt_to_variantvt(tinfo, tdesc, &param->vt)))
+        {
+            heap_free(plan);
+            return NULL;
+        }
+
+        if (param->vt == VT_DISPATCH || param->vt == VT_UNKNOWN)
+        {
+            if (tdesc->vt == VT_PTR)
+                tdesc = tdesc->u.lptdesc;
+            if (tdesc->vt == VT_USERDEFINED)
+                param->has_iid = SUCCEEDED(get_iface_guid(tinfo, tdesc->u.hreftype, &param->iid));
+        }
+    }
+
+    if (func_desc->elemdescFunc.tdesc.vt == VT_VOID)
+        plan->ret_vt = VT_EMPTY;
+    else
+    {
+        plan->ret_vt = 0;
+        if (FAILED(typedescvt_to_variantvt(tinfo, &func_desc->elemdescFunc.tdesc, &plan->ret_vt)))
+        {
+            heap_free(plan);
+            return NULL;
+        }
+    }
+
+    if (InterlockedCompareExchangePointer((void **)&func->invoke_plan, plan, NULL))
+    {
+        heap_free(plan);
+        plan = func->invoke_plan;
+    }
+    return plan;
+}
+
 #define INVBUF_ELEMENT_SIZE \
     (sizeof(VARIANTARG) + sizeof(VARIANTARG) + sizeof(VARIANTARG *) + sizeof(VARTYPE))
 #define INVBUF_GET_ARG_ARRAY(buffer, params) (buffer)
@@ -7221,7 +7464,7 @@ static HRESULT WINAPI ITypeInfo_fnInvoke(
     unsigned int var_index;
     TYPEKIND type_kind;
     HRESULT hres;
-    const TLBFuncDesc *pFuncInfo;
+    TLBFuncDesc *pFuncInfo;
     UINT fdc;
 
     TRACE("(%p)(%p,id=%d,flags=0x%08x,%p,%p,%p,%p)\n",
@@ -7268,6 +7511,7 @@ static HRESULT WINAPI ITypeInfo_fnInvoke(
 	switch (func_desc->funckind) {
 	case FUNC_PUREVIRTUAL:
 	case FUNC_VIRTUAL: {
+            const TLBInvokePlan *plan = typeinfo_get_invoke_plan(This, pFuncInfo);
             void *buffer = heap_alloc_zero(INVBUF_ELEMENT_SIZE * func_desc->cParams);
             VARIANT varresult;
             VARIANT retval = {{{0}}}; /* pointer for storing byref retvals in */
@@ -7299,12 +7543,20 @@ static HRESULT WINAPI ITypeInfo_fnInvoke(
                 goto func_fail;
             }
 
-            for (i = 0; i < func_desc->cParams; i++)
+            if (plan)
             {
-                TYPEDESC *tdesc = &func_desc->lprgelemdescParam[i].tdesc;
-                hres = typedescvt_to_variantvt((ITypeInfo *)iface, tdesc, &rgvt[i]);
-                if (FAILED(hres))
-                    goto func_fail;
+                for (i = 0; i < func_desc->cParams; i++)
+                    rgvt[i] = plan->params[i].vt;
+            }
+            else
+            {
+                for (i = 0; i < func_desc->cParams; i++)
+                {
+                    TYPEDESC *tdesc = &func_desc->lprgelemdescParam[i].tdesc;
+                    hres = typedescvt_to_variantvt((ITypeInfo *)iface, tdesc, &rgvt[i]);
+                    if (FAILED(hres))
+                        goto func_fail;
+                }
             }
 
             TRACE("changing args\n");
@@ -7467,12 +7719,17 @@ static HRESULT WINAPI ITypeInfo_fnInvoke(
                         IUnknown *userdefined_iface;
                         GUID guid;
 
-                        if (tdesc->vt == VT_PTR)
-                            tdesc = tdesc->u.lptdesc;
+                        if (plan && plan->params[i].has_iid)
+                            guid = plan->params[i].iid;
+                        else
+                        {
+                            if (tdesc->vt == VT_PTR)
+                                tdesc = tdesc->u.lptdesc;
 
-                        hres = get_iface_guid((ITypeInfo*)iface, tdesc->u.hreftype, &guid);
-                        if(FAILED(hres))
-                            break;
+                            hres = get_iface_guid((ITypeInfo*)iface, tdesc->u.hreftype, &guid);
+                            if(FAILED(hres))
+                                break;
+                        }
 
                         hres = IUnknown_QueryInterface(V_UNKNOWN(prgpvarg[i]), &guid, (void**)&userdefined_iface);
                         if(FAILED(hres)) {
@@ -7524,7 +7781,9 @@ static HRESULT WINAPI ITypeInfo_fnInvoke(
 
             /* VT_VOID is a special case for return types, so it is not
              * handled in the general function */
-            if (func_desc->elemdescFunc.tdesc.vt == VT_VOID)
+            if (plan)
+                V_VT(&varresult) = plan->ret_vt;
+            else if (func_desc->elemdescFunc.tdesc.vt == VT_VOID)
                 V_VT(&varresult) = VT_EMPTY;
             else
             {
@@ -7912,6 +8171,7 @@ static HRESULT WINAPI ITypeInfo_fnGetRefTypeInfo(
 
         *pTypeInfoImpl = *This;
         pTypeInfoImpl->ref = 0;
+        pTypeInfoImpl->name_hash = NULL;
         list_init(&pTypeInfoImpl->custdata_list);
 
         if (This->typeattr.typekind == TKIND_INTERFACE)
@@ -10809,6 +11069,8 @@ static HRESULT WINAPI ICreateTypeInfo2_fnAddFuncDesc(ICreateTypeInfo2 *iface,
 
     tmp_func_desc.pParamDesc = TLBParDesc_Constructor(funcDesc->cParams);
 
+    typeinfo_invalidate_caches(This);
+
     if (This->funcdescs) {
         This->funcdescs = HeapReAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, This->funcdescs,
                 sizeof(TLBFuncDesc) * (This->typeattr.cFuncs + 1));
@@ -10963,6 +11225,8 @@ static HRESULT WINAPI ICreateTypeInfo2_fnAddVarDesc(ICreateTypeInfo2 *iface,
 
     TRACE("%p %u %p\n", This, index, varDesc);
 
+    typeinfo_invalidate_caches(This);
+
     if (This->vardescs){
         UINT i;
 
@@ -11030,6 +11294,8 @@ static HRESULT WINAPI ICreateTypeInfo2_fnSetFuncAndParamNames(ICreateTypeInfo2 *
         }
     }
 
+    typeinfo_invalidate_caches(This);
+
     func_desc->Name = TLB_append_str(&This->pTypeLib->name_list, *names);
 
     for (i = 1; i < numNames; ++i) {
@@ -11053,6 +11319,8 @@ static HRESULT WINAPI ICreateTypeInfo2_fnSetVarName(ICreateTypeInfo2 *iface,
     if(index >= This->typeattr.cVars)
         return TYPE_E_ELEMENTNOTFOUND;
 
+    typeinfo_invalidate_caches(This);
+
     This->vardescs[index].Name = TLB_append_str(&This->pTypeLib->name_list, name);
     return S_OK;
 }
@@ -11195,6 +11463,7 @@ static HRESULT WINAPI ICreateTypeInfo2_fnLayOut(ICreateTypeInfo2 *iface)
     TRACE("%p\n", This);
 
     This->needs_layout = FALSE;
+    typeinfo_invalidate_caches(This);
 
     if (This->typeattr.typekind == TKIND_INTERFACE) {
         ITypeInfo *inh;
@@ -11328,6 +11597,7 @@ static HRESULT WINAPI ICreateTypeInfo2_fnDeleteFuncDesc(ICreateTypeInfo2 *iface,
     if (index >= This->typeattr.cFuncs)
         return TYPE_E_ELEMENTNOTFOUND;
 
+    typeinfo_invalidate_caches(This);
     typeinfo_release_funcdesc(&This->funcdescs[index]);
 
     --This->typeattr.cFuncs;
@@ -999,7 +999,23 @@ HRESULT WINAPI VariantChangeTypeEx(VARIANTARG* pvargDest, const VARIANTARG* pvar
           VariantClear(&vSrcDeref);
         }
 
-        if (SUCCEEDED(res))
+        if (SUCCEEDED(res) && !(V_VT(pvargSrc) & (VT_BYREF|VT_ARRAY)) && !(vt & VT_ARRAY))
+        {
+          /* By-value sources are converted directly, without a private copy. The
+           * result is built in vTmp and moved to the destination, which works for
+           * in place conversions and avoids copying the result a second time.
+           */
+          res = VARIANT_Coerce(&vTmp, lcid, wFlags, (VARIANTARG *)pvargSrc, vt);
+          if (SUCCEEDED(res))
+          {
+            V_VT(&vTmp) = vt;
+            if (SUCCEEDED(res = VariantClear(pvargDest)))
+              *pvargDest = vTmp;
+            else
+              VariantClear(&vTmp);
+          }
+        }
+        else if (SUCCEEDED(res))
         {
           res = VariantCopyInd(&vSrcDeref, pvargSrc);
           if (SUCCEEDED(res))
@@ -1509,13 +1525,47 @@ typedef struct tagVARIANT_NUMBER_CHARS
     if (buff[0]) lpChars->name = buff[0]; \
   TRACE("lcid 0x%x, " #name "=%s\n", lcid, wine_dbgstr_wn(&lpChars->name, 1))
 
+/* Number characters of the last locale that is not affected by user overrides.
+ * Those come from kernel resources which are slow to look up for every number,
+ * while user overrides may change at any time and are never cached here. */
+static struct
+{
+  LCID lcid;
+  DWORD dwFlags;
+  VARIANT_NUMBER_CHARS chars;
+} number_chars_cache = { ~0u };
+
+static CRITICAL_SECTION cs_number_chars;
+static CRITICAL_SECTION_DEBUG cs_number_chars_dbg =
+{
+    0, 0, &cs_number_chars,
+    { &cs_number_chars_dbg.ProcessLocksList, &cs_number_chars_dbg.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": number_chars") }
+};
+static CRITICAL_SECTION cs_number_chars = { &cs_number_chars_dbg, -1, 0, 0, 0, 0 };
+
 /* Get the valid number characters for an lcid */
 static void VARIANT_GetLocalisedNumberChars(VARIANT_NUMBER_CHARS *lpChars, LCID lcid, DWORD dwFlags)
 {
   static const VARIANT_NUMBER_CHARS defaultChars = { '-','+','.',0,1,{'$',0},0,',' };
   LCTYPE lctype = dwFlags & LOCALE_NOUSEROVERRIDE;
+  BOOL cacheable;
   WCHAR buff[4];
 
+  lcid = ConvertDefaultLocale(lcid);
+  cacheable = lctype || lcid != ConvertDefaultLocale(LOCALE_USER_DEFAULT);
+  if (cacheable)
+  {
+    EnterCriticalSection(&cs_number_chars);
+    if (number_chars_cache.lcid == lcid && number_chars_cache.dwFlags == lctype)
+    {
+      *lpChars = number_chars_cache.chars;
+      LeaveCriticalSection(&cs_number_chars);
+      return;
+    }
+    LeaveCriticalSection(&cs_number_chars);
+  }
+
   memcpy(lpChars, &defaultChars, sizeof(defaultChars));
   GET_NUMBER_TEXT(LOCALE_SNEGATIVESIGN, cNegativeSymbol);
   GET_NUMBER_TEXT(LOCALE_SPOSITIVESIGN, cPositiveSymbol);
@@ -1534,6 +1584,15 @@ static void VARIANT_GetLocalisedNumberChars(VARIANT_NUMBER_CHARS *lpChars, LCID
     wcscpy(lpChars->sCurrency, L"$");
   lpChars->sCurrencyLen = wcslen(lpChars->sCurrency);
   TRACE("lcid 0x%x, sCurrency=%u %s\n", lcid, lpChars->sCurrencyLen, wine_dbgstr_w(lpChars->sCurrency));
+
+  if (cacheable)
+  {
+    EnterCriticalSection(&cs_number_chars);
+    number_chars_cache.lcid = lcid;
+    number_chars_cache.dwFlags = lctype;
+    number_chars_cache.chars = *lpChars;
+    LeaveCriticalSection(&cs_number_chars);
+  }
 }
 
 /* Number Parsing States */
@@ -6540,15 +6540,24 @@ static BSTR VARIANT_BstrReplaceDecimal(const WCHAR * buff, LCID lcid, ULONG dwFl
 static HRESULT VARIANT_BstrFromReal(DOUBLE dblIn, LCID lcid, ULONG dwFlags,
                                     BSTR* pbstrOut, LPCWSTR lpszFormat)
 {
+  static _locale_t c_locale;
   _locale_t locale;
   WCHAR buff[256];
 
   if (!pbstrOut)
     return E_INVALIDARG;
 
-  if (!(locale = _create_locale(LC_ALL, "C"))) return E_OUTOFMEMORY;
+  /* The C locale is created once and kept for the lifetime of the process. */
+  if (!(locale = c_locale))
+  {
+    if (!(locale = _create_locale(LC_ALL, "C"))) return E_OUTOFMEMORY;
+    if (InterlockedCompareExchangePointer((void **)&c_locale, locale, NULL))
+    {
+      _free_locale(locale);
+      locale = c_locale;
+    }
+  }
   _swprintf_l(buff, ARRAY_SIZE(buff), lpszFormat, locale, dblIn);
-  _free_locale(locale);
 
   /* Negative zeroes are disallowed (some applications depend on this).
      If buff starts with a minus, and then nothing follows but zeroes
@@ -1841,6 +1841,75 @@ void WINAPI NdrSimpleStructFree(PMIDL_STUB_MESSAGE pStubMsg,
     EmbeddedPointerFree(pStubMsg, pMemory, pFormat+4);
 }
 
+static ULONG flat_member_size(unsigned char fc)
+{
+  switch (fc) {
+  case FC_BYTE:
+  case FC_CHAR:
+  case FC_SMALL:
+  case FC_USMALL:
+    return 1;
+  case FC_WCHAR:
+  case FC_SHORT:
+  case FC_USHORT:
+    return 2;
+  case FC_LONG:
+  case FC_ULONG:
+  case FC_ENUM32:
+  case FC_FLOAT:
+    return 4;
+  case FC_HYPER:
+  case FC_DOUBLE:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+/* returns the size of a complex struct member layout that only consists of
+ * base types and nested complex structs of them without any padding, and thus
+ * has the same representation in memory and on the wire, or 0 if the members
+ * need to be interpreted */
+static ULONG get_flat_complex_struct_size(PFORMAT_STRING pFormat)
+{
+  ULONG size = 0, member_size;
+  PFORMAT_STRING desc;
+
+  for (; *pFormat != FC_END; pFormat++) {
+    switch (*pFormat) {
+    case FC_EMBEDDED_COMPLEX:
+      if (pFormat[1]) return 0;
+      desc = pFormat + 2 + *(const SHORT*)(pFormat + 2);
+      /* no conformant array and no pointer layout */
+      if (*desc != FC_BOGUS_STRUCT || *(const SHORT*)(desc + 4) || *(const WORD*)(desc + 6))
+        return 0;
+      if (size & desc[1]) return 0;
+      /* trailing padding changes the stride in memory */
+      if (!(member_size = get_flat_complex_struct_size(desc + 8)) ||
+          member_size != *(const WORD*)(desc + 2))
+        return 0;
+      size += member_size;
+      pFormat += 3;
+      break;
+    case FC_ALIGNM2:
+      if (size & 1) return 0;
+      break;
+    case FC_ALIGNM4:
+      if (size & 3) return 0;
+      break;
+    case FC_ALIGNM8:
+      if (size & 7) return 0;
+      break;
+    case FC_PAD:
+      break;
+    default:
+      if (!(member_size = flat_member_size(*pFormat))) return 0;
+      size += member_size;
+    }
+  }
+  return size;
+}
+
 /* Array helpers */
 
 static inline void array_compute_and_size_conformance(
@@ -2083,6 +2152,12 @@ static inline void array_write_variance_and_marshall(
     align_pointer_clear(&pStubMsg->Buffer, alignment);
 
     size = pStubMsg->ActualCount;
+    /* elements without padding or pointers have the same layout in memory and on the wire */
+    if ((esize = get_flat_complex_struct_size(pFormat)))
+    {
+      safe_copy_to_buffer(pStubMsg, pMemory, safe_multiply(esize, size));
+      break;
+    }
     for (i = 0; i < size; i++)
       pMemory = ComplexMarshall(pStubMsg, pMemory, pFormat, NULL);
     break;
@@ -2287,6 +2362,11 @@ static inline ULONG array_read_variance_and_unmarshall(
 
     pMemory = *ppMemory;
     count = pStubMsg->ActualCount;
+    if (get_flat_complex_struct_size(pFormat))
+    {
+      safe_copy_from_buffer(pStubMsg, pMemory, safe_multiply(esize, count));
+      return pStubMsg->Buffer - saved_buffer;
+    }
     for (i = 0; i < count; i++)
         pMemory = ComplexUnmarshall(pStubMsg, pMemory, pFormat, NULL, fMustAlloc);
     return pStubMsg->Buffer - saved_buffer;
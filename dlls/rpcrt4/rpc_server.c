@@ -622,9 +622,41 @@ exit:
   return 0;
 }
 
+static TP_CALLBACK_ENVIRON io_environment;
+static INIT_ONCE io_pool_once = INIT_ONCE_STATIC_INIT;
+
+/* Connection receive loops run for the whole lifetime of a connection, so
+ * they get their own pool without a practical thread limit. Sharing the
+ * default pool with the request work items could leave no thread to
+ * dispatch requests once enough connections are open. */
+static BOOL CALLBACK init_io_pool(INIT_ONCE *once, void *param, void **context)
+{
+  PTP_POOL pool;
+
+  if (!(pool = CreateThreadpool(NULL))) return FALSE;
+  SetThreadpoolThreadMaximum(pool, MAXLONG);
+  io_environment.Version = 1;
+  io_environment.Pool = pool;
+  io_environment.u.s.LongFunction = 1;
+  return TRUE;
+}
+
+static void CALLBACK RPCRT4_io_callback(TP_CALLBACK_INSTANCE *instance, void *the_arg)
+{
+  RPCRT4_io_thread(the_arg);
+}
+
 void RPCRT4_new_client(RpcConnection* conn)
 {
-  HANDLE thread = CreateThread(NULL, 0, RPCRT4_io_thread, conn, 0, NULL);
+  HANDLE thread;
+
+  /* run the connection's receive loop on a pooled thread, so that
+   * short-lived local connections don't pay for a thread creation each */
+  if (InitOnceExecuteOnce(&io_pool_once, init_io_pool, NULL, NULL) &&
+      TrySubmitThreadpoolCallback(RPCRT4_io_callback, conn, &io_environment))
+    return;
+
+  thread = CreateThread(NULL, 0, RPCRT4_io_thread, conn, 0, NULL);
   if (!thread) {
     DWORD err = GetLastError();
     ERR("failed to create thread, error=%08x\n", err);
@@ -1270,6 +1270,267 @@ static void test_struct_align(void)
     heap_free(memsrc_orig);
 }
 
+struct pointer_members
+{
+    LONG a;
+    LONG *p;
+    LONG b;
+    short c;
+};
+
+static void test_struct_pointer_members(void)
+{
+    RPC_MESSAGE RpcMessage;
+    MIDL_STUB_MESSAGE StubMsg;
+    MIDL_STUB_DESC StubDesc;
+    struct pointer_members memsrc, *mem;
+    LONG l = 0xcafebabe;
+    void *ptr;
+    DWORD *buf;
+
+    /* the members following the pointer must still be marshalled individually */
+    static const unsigned char fmtstr[] =
+    {
+#ifdef _WIN64
+        0x1a,   /* FC_BOGUS_STRUCT */
+        0x7,    /* alignment 8 */
+        NdrFcShort(0x18),   /* memory size 24 */
+        NdrFcShort(0x0),
+        NdrFcShort(0xa),    /* Offset= 10 (16) */
+        0x08,   /* FC_LONG */
+        0x39,   /* FC_ALIGNM8 */
+#else
+        0x1a,   /* FC_BOGUS_STRUCT */
+        0x3,    /* alignment 4 */
+        NdrFcShort(0x10),   /* memory size 16 */
+        NdrFcShort(0x0),
+        NdrFcShort(0xa),    /* Offset= 10 (16) */
+        0x08,   /* FC_LONG */
+        0x5c,   /* FC_PAD */
+#endif
+        0x36,   /* FC_POINTER */
+        0x08,   /* FC_LONG */
+        0x06,   /* FC_SHORT */
+        0x3e,   /* FC_STRUCTPAD2 */
+        0x5c,   /* FC_PAD */
+        0x5b,   /* FC_END */
+        0x12, 0x8,  /* FC_UP [simple_pointer] */
+        0x08,   /* FC_LONG */
+        0x5c,   /* FC_PAD */
+    };
+
+    memset(&memsrc, 0, sizeof(memsrc));
+    memsrc.a = 0xdeadbeef;
+    memsrc.p = &l;
+    memsrc.b = 0x12345678;
+    memsrc.c = 0x1234;
+
+    StubDesc = Object_StubDesc;
+    StubDesc.pFormatTypes = fmtstr;
+    NdrClientInitializeNew(&RpcMessage, &StubMsg, &StubDesc, 0);
+
+    StubMsg.BufferLength = 0;
+    NdrComplexStructBufferSize(&StubMsg, (unsigned char *)&memsrc, fmtstr);
+    ok(StubMsg.BufferLength >= 20, "length %d\n", StubMsg.BufferLength);
+
+    StubMsg.RpcMsg->Buffer = StubMsg.BufferStart = StubMsg.Buffer = heap_alloc(StubMsg.BufferLength);
+    StubMsg.BufferEnd = StubMsg.BufferStart + StubMsg.BufferLength;
+
+    ptr = NdrComplexStructMarshall(&StubMsg, (unsigned char *)&memsrc, fmtstr);
+    ok(ptr == NULL, "ret %p\n", ptr);
+    ok(StubMsg.Buffer - StubMsg.BufferStart == 20, "got length %d\n", (int)(StubMsg.Buffer - StubMsg.BufferStart));
+
+    buf = (DWORD *)StubMsg.BufferStart;
+    ok(buf[0] == 0xdeadbeef, "got %08x\n", buf[0]);
+    ok(buf[1] != 0, "pointer id should be non-zero\n");
+    ok(buf[2] == 0x12345678, "got %08x\n", buf[2]);
+    ok(*(short *)&buf[3] == 0x1234, "got %04x\n", *(short *)&buf[3]);
+    ok(buf[4] == 0xcafebabe, "got %08x\n", buf[4]);
+
+    /* Server */
+    StubMsg.IsClient = 0;
+    mem = NULL;
+    StubMsg.Buffer = StubMsg.BufferStart;
+    ptr = NdrComplexStructUnmarshall(&StubMsg, (unsigned char **)&mem, fmtstr, 0);
+    ok(ptr == NULL, "ret %p\n", ptr);
+    ok(mem->a == memsrc.a, "got a %08x\n", mem->a);
+    ok(mem->p && *mem->p == l, "got p %p\n", mem->p);
+    ok(mem->b == memsrc.b, "got b %08x\n", mem->b);
+    ok(mem->c == memsrc.c, "got c %04x\n", mem->c);
+
+    StubMsg.Buffer = StubMsg.BufferStart;
+    NdrComplexStructFree(&StubMsg, (unsigned char *)mem, fmtstr);
+    StubMsg.pfnFree(mem);
+
+    heap_free(StubMsg.RpcMsg->Buffer);
+}
+
+struct flat_complex
+{
+    LONG a;
+    short b;
+    short c;
+    LONGLONG d;
+};
+
+struct padded_complex
+{
+    short a;
+    LONG b;
+    char c;
+};
+
+static void test_bogus_struct_array(void)
+{
+    RPC_MESSAGE RpcMessage;
+    MIDL_STUB_MESSAGE StubMsg;
+    MIDL_STUB_DESC StubDesc;
+    struct flat_complex flat_src[3], *flat;
+    struct padded_complex padded_src[3], *padded;
+    unsigned int i;
+    void *ptr;
+    DWORD *buf;
+
+    /* elements without padding, with the array aligned to 8 */
+    static const unsigned char fmtstr_flat[] =
+    {
+/*  0 */        0x21,           /* FC_BOGUS_ARRAY */
+                0x7,            /* 7 */
+/*  2 */        NdrFcShort( 0x0 ),      /* 0 */
+/*  4 */        0x40,           /* Corr desc:  const */
+                0x0,
+/*  6 */        NdrFcShort( 0x3 ),      /* 3 */
+/*  8 */        NdrFcLong( 0xffffffff ),        /* -1 */
+/* 12 */        0x4c,           /* FC_EMBEDDED_COMPLEX */
+                0x0,            /* 0 */
+/* 14 */        NdrFcShort( 0x4 ),      /* Offset= 4 (18) */
+/* 16 */        0x5c,           /* FC_PAD */
+                0x5b,           /* FC_END */
+/* 18 */        0x1a,           /* FC_BOGUS_STRUCT */
+                0x7,            /* 7 */
+/* 20 */        NdrFcShort( 0x10 ),     /* 16 */
+/* 22 */        NdrFcShort( 0x0 ),      /* 0 */
+/* 24 */        NdrFcShort( 0x0 ),      /* 0 */
+/* 26 */        0x8,            /* FC_LONG */
+                0x6,            /* FC_SHORT */
+/* 28 */        0x6,            /* FC_SHORT */
+                0x39,           /* FC_ALIGNM8 */
+/* 30 */        0xb,            /* FC_HYPER */
+                0x5b,           /* FC_END */
+    };
+
+    /* elements with padding between and after the members */
+    static const unsigned char fmtstr_padded[] =
+    {
+/*  0 */        0x21,           /* FC_BOGUS_ARRAY */
+                0x3,            /* 3 */
+/*  2 */        NdrFcShort( 0x0 ),      /* 0 */
+/*  4 */        0x40,           /* Corr desc:  const */
+                0x0,
+/*  6 */        NdrFcShort( 0x3 ),      /* 3 */
+/*  8 */        NdrFcLong( 0xffffffff ),        /* -1 */
+/* 12 */        0x4c,           /* FC_EMBEDDED_COMPLEX */
+                0x0,            /* 0 */
+/* 14 */        NdrFcShort( 0x4 ),      /* Offset= 4 (18) */
+/* 16 */        0x5c,           /* FC_PAD */
+                0x5b,           /* FC_END */
+/* 18 */        0x1a,           /* FC_BOGUS_STRUCT */
+                0x3,            /* 3 */
+/* 20 */        NdrFcShort( 0xc ),      /* 12 */
+/* 22 */        NdrFcShort( 0x0 ),      /* 0 */
+/* 24 */        NdrFcShort( 0x0 ),      /* 0 */
+/* 26 */        0x6,            /* FC_SHORT */
+                0x38,           /* FC_ALIGNM4 */
+/* 28 */        0x8,            /* FC_LONG */
+                0x2,            /* FC_CHAR */
+/* 30 */        0x3f,           /* FC_STRUCTPAD3 */
+                0x5b,           /* FC_END */
+    };
+
+    for (i = 0; i < 3; i++)
+    {
+        flat_src[i].a = 0x11111111 * (i + 1);
+        flat_src[i].b = 0x2222 + i;
+        flat_src[i].c = 0x3333 + i;
+        flat_src[i].d = ((ULONGLONG)0xbadefeed << 32) | (0x2468ace0 + i);
+    }
+
+    StubDesc = Object_StubDesc;
+    StubDesc.pFormatTypes = fmtstr_flat;
+    NdrClientInitializeNew(&RpcMessage, &StubMsg, &StubDesc, 0);
+
+    StubMsg.BufferLength = 0;
+    NdrComplexArrayBufferSize(&StubMsg, (unsigned char *)flat_src, fmtstr_flat);
+    ok(StubMsg.BufferLength >= 56, "length %d\n", StubMsg.BufferLength);
+
+    StubMsg.RpcMsg->Buffer = StubMsg.BufferStart = StubMsg.Buffer = heap_alloc(StubMsg.BufferLength);
+    StubMsg.BufferEnd = StubMsg.BufferStart + StubMsg.BufferLength;
+
+    ptr = NdrComplexArrayMarshall(&StubMsg, (unsigned char *)flat_src, fmtstr_flat);
+    ok(ptr == NULL, "ret %p\n", ptr);
+    ok(StubMsg.Buffer - StubMsg.BufferStart == 56, "got length %d\n", (int)(StubMsg.Buffer - StubMsg.BufferStart));
+    buf = (DWORD *)StubMsg.BufferStart;
+    ok(buf[0] == 3, "got count %u\n", buf[0]);
+    ok(!memcmp(buf + 2, flat_src, sizeof(flat_src)), "array wasn't marshalled correctly\n");
+
+    /* Server */
+    StubMsg.IsClient = 0;
+    flat = NULL;
+    StubMsg.Buffer = StubMsg.BufferStart;
+    ptr = NdrComplexArrayUnmarshall(&StubMsg, (unsigned char **)&flat, fmtstr_flat, 0);
+    ok(ptr == NULL, "ret %p\n", ptr);
+    ok(StubMsg.Buffer - StubMsg.BufferStart == 56, "got length %d\n", (int)(StubMsg.Buffer - StubMsg.BufferStart));
+    ok(!memcmp(flat, flat_src, sizeof(flat_src)), "array wasn't unmarshalled correctly\n");
+    StubMsg.pfnFree(flat);
+    heap_free(StubMsg.RpcMsg->Buffer);
+
+    memset(padded_src, 0xcc, sizeof(padded_src));
+    for (i = 0; i < 3; i++)
+    {
+        padded_src[i].a = 0x1111 * (i + 1);
+        padded_src[i].b = 0x22222222 + i;
+        padded_src[i].c = 0x33 + i;
+    }
+
+    StubDesc.pFormatTypes = fmtstr_padded;
+    NdrClientInitializeNew(&RpcMessage, &StubMsg, &StubDesc, 0);
+
+    StubMsg.BufferLength = 0;
+    NdrComplexArrayBufferSize(&StubMsg, (unsigned char *)padded_src, fmtstr_padded);
+    ok(StubMsg.BufferLength >= 37, "length %d\n", StubMsg.BufferLength);
+
+    StubMsg.RpcMsg->Buffer = StubMsg.BufferStart = StubMsg.Buffer = heap_alloc(StubMsg.BufferLength);
+    StubMsg.BufferEnd = StubMsg.BufferStart + StubMsg.BufferLength;
+
+    ptr = NdrComplexArrayMarshall(&StubMsg, (unsigned char *)padded_src, fmtstr_padded);
+    ok(ptr == NULL, "ret %p\n", ptr);
+    ok(StubMsg.Buffer - StubMsg.BufferStart == 37, "got length %d\n", (int)(StubMsg.Buffer - StubMsg.BufferStart));
+    buf = (DWORD *)StubMsg.BufferStart;
+    ok(buf[0] == 3, "got count %u\n", buf[0]);
+    for (i = 0; i < 3; i++)
+    {
+        ok(*(short *)&buf[1 + 3 * i] == padded_src[i].a, "%u: got a %04x\n", i, *(short *)&buf[1 + 3 * i]);
+        ok(buf[2 + 3 * i] == padded_src[i].b, "%u: got b %08x\n", i, buf[2 + 3 * i]);
+        ok(*(char *)&buf[3 + 3 * i] == padded_src[i].c, "%u: got c %02x\n", i, *(char *)&buf[3 + 3 * i]);
+    }
+
+    /* Server */
+    StubMsg.IsClient = 0;
+    padded = NULL;
+    StubMsg.Buffer = StubMsg.BufferStart;
+    ptr = NdrComplexArrayUnmarshall(&StubMsg, (unsigned char **)&padded, fmtstr_padded, 0);
+    ok(ptr == NULL, "ret %p\n", ptr);
+    ok(StubMsg.Buffer - StubMsg.BufferStart == 37, "got length %d\n", (int)(StubMsg.Buffer - StubMsg.BufferStart));
+    for (i = 0; i < 3; i++)
+    {
+        ok(padded[i].a == padded_src[i].a, "%u: got a %04x\n", i, padded[i].a);
+        ok(padded[i].b == padded_src[i].b, "%u: got b %08x\n", i, padded[i].b);
+        ok(padded[i].c == padded_src[i].c, "%u: got c %02x\n", i, padded[i].c);
+    }
+    StubMsg.pfnFree(padded);
+    heap_free(StubMsg.RpcMsg->Buffer);
+}
+
 struct testiface
 {
     IPersist IPersist_iface;
@@ -3009,6 +3270,8 @@ START_TEST( ndr_marshall )
     test_nontrivial_pointer_types();
     test_simple_struct();
     test_struct_align();
+    test_struct_pointer_members();
+    test_bogus_struct_array();
     test_iface_ptr();
     test_fullpointer_xlat();
     test_client_init();
@@ -33,6 +33,7 @@
 #include "winuser.h"
 #include "winnt.h"
 #include "winternl.h"
+#include "winreg.h"
 #include "wine/debug.h"
 #include "wine/list.h"
 #include "ole2.h"
@@ -70,6 +71,15 @@ static unsigned int handled_count;
 static unsigned int handled_total;
 static WCHAR **handled_dlls;
 static IRegistrar *registrar;
+static HKEY hash_key;
+
+/* recorded for every installed fake dll, so that unchanged dlls are
+ * neither rewritten nor registered again on prefix updates */
+struct fake_dll_hash
+{
+    ULONGLONG size;
+    DWORD     crc;
+};
 
 struct dll_info
 {
@@ -845,7 +855,7 @@ static BOOL CALLBACK register_manifest( HMODULE module, const WCHAR *type, WCHAR
 
 static BOOL CALLBACK register_resource( HMODULE module, LPCWSTR type, LPWSTR name, LONG_PTR arg )
 {
-    HRESULT *hr = (HRESULT *)arg;
+    HRESULT *hr = (HRESULT *)arg, res;
     WCHAR *buffer;
     HRSRC rsrc = FindResourceW( module, name, type );
     char *str = LoadResource( module, rsrc );
@@ -856,28 +866,34 @@ static BOOL CALLBACK register_resource( HMODULE module, LPCWSTR type, LPWSTR nam
     if (!(buffer = HeapAlloc( GetProcessHeap(), 0, lenW * sizeof(WCHAR) ))) return FALSE;
     MultiByteToWideChar( CP_UTF8, 0, str, lenA, buffer, lenW );
     buffer[lenW - 1] = 0;
-    *hr = IRegistrar_StringRegister( registrar, buffer );
+    /* keep the first failure, later scripts must not hide it */
+    if (FAILED(res = IRegistrar_StringRegister( registrar, buffer )) && SUCCEEDED(*hr)) *hr = res;
     HeapFree( GetProcessHeap(), 0, buffer );
     return TRUE;
 }
 
-static void register_fake_dll( const WCHAR *name, const void *data, size_t size, struct list *delay_copy )
+static void register_fake_dll_manifests( const WCHAR *name, const void *data, struct list *delay_copy )
 {
-    const IMAGE_RESOURCE_DIRECTORY *resdir;
-    LDR_RESOURCE_INFO info;
-    HRESULT hr = S_OK;
     HMODULE module = (HMODULE)((ULONG_PTR)data | 1);
     struct dll_data dll_data = { delay_copy, name, 0 };
-    WCHAR buffer[MAX_PATH];
     const WCHAR *p;
 
     if (!(p = wcsrchr( name, '\\' ))) p = name;
     else p++;
     dll_data.src_len = p - name;
     EnumResourceNamesW( module, (WCHAR*)RT_MANIFEST, register_manifest, (LONG_PTR)&dll_data );
+}
+
+static HRESULT register_fake_dll_scripts( const WCHAR *name, const void *data )
+{
+    const IMAGE_RESOURCE_DIRECTORY *resdir;
+    LDR_RESOURCE_INFO info;
+    HRESULT hr = S_OK;
+    HMODULE module = (HMODULE)((ULONG_PTR)data | 1);
+    WCHAR buffer[MAX_PATH];
 
     info.Type = (ULONG_PTR)L"WINE_REGISTRY";
-    if (LdrFindResourceDirectory_U( module, &info, 1, &resdir )) return;
+    if (LdrFindResourceDirectory_U( module, &info, 1, &resdir )) return S_OK;
 
     if (!registrar)
     {
@@ -892,7 +908,7 @@ static void register_fake_dll( const WCHAR *name, const void *data, size_t size,
         if (!registrar)
         {
             ERR( "failed to create IRegistrar: %x\n", hr );
-            return;
+            return hr;
         }
     }
 
@@ -903,6 +919,68 @@ static void register_fake_dll( const WCHAR *name, const void *data, size_t size,
     IRegistrar_AddReplacement( registrar, L"SystemRoot", buffer );
     EnumResourceNamesW( module, L"WINE_REGISTRY", register_resource, (LONG_PTR)&hr );
     if (FAILED(hr)) ERR( "failed to register %s: %x\n", debugstr_w(name), hr );
+    return hr;
+}
+
+static HRESULT register_fake_dll( const WCHAR *name, const void *data, size_t size, struct list *delay_copy )
+{
+    register_fake_dll_manifests( name, data, delay_copy );
+    return register_fake_dll_scripts( name, data );
+}
+
+static HKEY open_hash_key(void)
+{
+    if (!hash_key && RegCreateKeyExW( HKEY_LOCAL_MACHINE, L"Software\\Wine\\FakeDlls", 0, NULL, 0,
+                                      KEY_QUERY_VALUE | KEY_SET_VALUE, NULL, &hash_key, NULL ))
+        hash_key = 0;
+    return hash_key;
+}
+
+static void get_fake_dll_hash( const void *data, SIZE_T size, struct fake_dll_hash *hash )
+{
+    hash->size = size;
+    hash->crc = RtlComputeCrc32( 0, data, size );
+}
+
+/* check whether the same data was already installed at name */
+static BOOL is_fake_dll_up_to_date( const WCHAR *name, const void *data, SIZE_T size )
+{
+    struct fake_dll_hash hash, recorded;
+    DWORD type, len = sizeof(recorded);
+    LARGE_INTEGER file_size;
+    HANDLE h;
+    BOOL ret;
+    HKEY key;
+
+    if (!(key = open_hash_key())) return FALSE;
+    if (RegQueryValueExW( key, name, NULL, &type, (BYTE *)&recorded, &len ) ||
+        type != REG_BINARY || len != sizeof(recorded) || recorded.size != size)
+        return FALSE;
+
+    /* the recorded hash can only be trusted if the file is still the fake dll we installed */
+    h = CreateFileW( name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL );
+    if (h == INVALID_HANDLE_VALUE) return FALSE;
+    ret = is_fake_dll( h ) && GetFileSizeEx( h, &file_size ) && file_size.QuadPart == size;
+    CloseHandle( h );
+    if (!ret) return FALSE;
+
+    get_fake_dll_hash( data, size, &hash );
+    return hash.crc == recorded.crc;
+}
+
+static void set_fake_dll_hash( const WCHAR *name, const void *data, SIZE_T size )
+{
+    struct fake_dll_hash hash;
+    HKEY key;
+
+    if (!(key = open_hash_key())) return;
+    if (!data)
+    {
+        RegDeleteValueW( key, name );
+        return;
+    }
+    get_fake_dll_hash( data, size, &hash );
+    RegSetValueExW( key, name, 0, REG_BINARY, (const BYTE *)&hash, sizeof(hash) );
 }
 
 /* copy a fake dll file to the dest directory */
@@ -928,7 +1006,15 @@ static int install_fake_dll( WCHAR *dest, WCHAR *file, BOOL delete, struct list
     destname[len] = 0;
     if (!add_handled_dll( destname )) ret = -1;
 
-    if (ret != -1)
+    if (ret != -1 && delete) set_fake_dll_hash( dest, NULL, 0 );
+
+    if (ret != -1 && !delete && is_fake_dll_up_to_date( dest, data, size ))
+    {
+        TRACE( "%s is up to date\n", debugstr_w(dest) );
+        /* the registry may have changed since, always register again */
+        if (FAILED(register_fake_dll( dest, data, size, delay_copy ))) set_fake_dll_hash( dest, NULL, 0 );
+    }
+    else if (ret != -1)
     {
         HANDLE h = create_dest_file( dest, delete );
 
@@ -950,7 +1036,14 @@ static int install_fake_dll( WCHAR *dest, WCHAR *file, BOOL delete, struct list
             ret = (WriteFile( h, data, size, &written, NULL ) && written == size);
             if (!ret) ERR( "failed to write to %s (error=%u)\n", debugstr_w(dest), GetLastError() );
             CloseHandle( h );
-            if (ret) register_fake_dll( dest, data, size, delay_copy );
+            if (ret)
+            {
+                /* only record dlls that were fully registered, so that failures are retried */
+                if (SUCCEEDED(register_fake_dll( dest, data, size, delay_copy )))
+                    set_fake_dll_hash( dest, data, size );
+                else
+                    set_fake_dll_hash( dest, NULL, 0 );
+            }
             else DeleteFileW( dest );
         }
     }
@@ -1133,4 +1226,6 @@ void cleanup_fake_dlls(void)
     handled_count = handled_total = 0;
     if (registrar) IRegistrar_Release( registrar );
     registrar = NULL;
+    if (hash_key) RegCloseKey( hash_key );
+    hash_key = 0;
 }
@@ -97,8 +97,8 @@ struct vcomp_team_data
     va_list                 valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    LONG                    barrier;
+    LONG                    barrier_count;
 };
 
 struct vcomp_task_data
@@ -109,7 +109,7 @@ struct vcomp_task_data
     /* section */
     unsigned int            section;
     int                     num_sections;
-    int                     section_index;
+    LONG64 DECLSPEC_ALIGN(8) section_state;
 
     /* dynamic */
     unsigned int            dynamic;
@@ -118,8 +118,19 @@ struct vcomp_task_data
     unsigned int            dynamic_iterations;
     int                     dynamic_step;
     unsigned int            dynamic_chunksize;
+    LONG64 DECLSPEC_ALIGN(8) dynamic_state;
 };
 
+/* The section and dynamic loop state words pack the generation of the
+ * construct in the high 32 bits and the number of remaining sections or
+ * iterations in the low 32 bits, so that work can be handed out with a
+ * single compare-and-swap. */
+#define VCOMP_STATE(gen, remaining) (((LONG64)(gen) << 32) | (unsigned int)(remaining))
+#define VCOMP_STATE_GEN(state)      ((unsigned int)((ULONG64)(state) >> 32))
+#define VCOMP_STATE_REMAINING(state) ((unsigned int)(state))
+
+#define VCOMP_BARRIER_SPIN_COUNT    4000
+
 static void **ptr_from_va_list(va_list valist)
 {
     return *(void ***)&valist;
@@ -133,6 +144,47 @@ static void copy_va_list_data(void **args, va_list valist, int args_count)
         args[i] = va_arg(valist, void *);
 }
 
+static inline LONG64 read_state(LONG64 *state)
+{
+#ifdef _WIN64
+    return *(volatile LONG64 *)state;
+#else
+    return InterlockedCompareExchange64(state, 0, 0);
+#endif
+}
+
+static inline void publish_state(LONG64 *state, LONG64 value)
+{
+    LONG64 old;
+    do old = read_state(state); while (InterlockedCompareExchange64(state, value, old) != old);
+}
+
+/* claim a construct for initialization, returns TRUE for the first thread of the team */
+static inline BOOL claim_construct(unsigned int *task_gen, unsigned int thread_gen)
+{
+    unsigned int gen;
+
+    for (;;)
+    {
+        gen = *(volatile unsigned int *)task_gen;
+        if ((int)(thread_gen - gen) <= 0) return FALSE;
+        if (InterlockedCompareExchange((LONG *)task_gen, thread_gen, gen) == gen) return TRUE;
+    }
+}
+
+/* wait until the current construct state is published, returns FALSE if the construct is over */
+static inline BOOL get_construct_state(LONG64 *state_ptr, unsigned int *task_gen,
+                                       unsigned int thread_gen, LONG64 *state)
+{
+    for (;;)
+    {
+        *state = read_state(state_ptr);
+        if (VCOMP_STATE_GEN(*state) == thread_gen) return TRUE;
+        if (*(volatile unsigned int *)task_gen != thread_gen) return FALSE;
+        YieldProcessor();
+    }
+}
+
 #if defined(__i386__)
 
 extern void CDECL _vcomp_fork_call_wrapper(void *wrapper, int nargs, void **args);
@@ -411,6 +463,8 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
     data->task.single           = 0;
     data->task.section          = 0;
     data->task.dynamic          = 0;
+    data->task.section_state    = 0;
+    data->task.dynamic_state    = 0;
 
     thread_data = &data->thread;
     thread_data->team           = NULL;
@@ -1057,26 +1111,35 @@ void CDECL _vcomp_flush(void)
 void CDECL _vcomp_barrier(void)
 {
     struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    LONG barrier;
+    int i;
 
     TRACE("()\n");
 
     if (!team_data)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    barrier = *(volatile LONG *)&team_data->barrier;
+    if (InterlockedIncrement(&team_data->barrier_count) >= team_data->num_threads)
     {
-        team_data->barrier++;
         team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
+        InterlockedIncrement(&team_data->barrier);
+        RtlWakeAddressAll(&team_data->barrier);
+        return;
     }
-    else
+
+    /* spinning only helps when every thread of the team has its own cpu */
+    if (team_data->num_threads <= vcomp_num_procs)
     {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+        for (i = 0; i < VCOMP_BARRIER_SPIN_COUNT; i++)
+        {
+            if (*(volatile LONG *)&team_data->barrier != barrier) return;
+            YieldProcessor();
+        }
     }
-    LeaveCriticalSection(&vcomp_section);
+
+    while (*(volatile LONG *)&team_data->barrier == barrier)
+        RtlWaitOnAddress(&team_data->barrier, &barrier, sizeof(barrier), NULL);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
@@ -1102,20 +1165,11 @@ int CDECL _vcomp_single_begin(int flags)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_task_data *task_data = thread_data->task;
-    int ret = FALSE;
 
     TRACE("(%x): semi-stub\n", flags);
 
-    EnterCriticalSection(&vcomp_section);
     thread_data->single++;
-    if ((int)(thread_data->single - task_data->single) > 0)
-    {
-        task_data->single = thread_data->single;
-        ret = TRUE;
-    }
-    LeaveCriticalSection(&vcomp_section);
-
-    return ret;
+    return claim_construct(&task_data->single, thread_data->single);
 }
 
 void CDECL _vcomp_single_end(void)
@@ -1131,33 +1185,32 @@ void CDECL _vcomp_sections_init(int n)
 
     TRACE("(%d)\n", n);
 
-    EnterCriticalSection(&vcomp_section);
     thread_data->section++;
-    if ((int)(thread_data->section - task_data->section) > 0)
+    if (claim_construct(&task_data->section, thread_data->section))
     {
-        task_data->section       = thread_data->section;
-        task_data->num_sections  = n;
-        task_data->section_index = 0;
+        task_data->num_sections = n;
+        publish_state(&task_data->section_state, VCOMP_STATE(thread_data->section, max(n, 0)));
     }
-    LeaveCriticalSection(&vcomp_section);
 }
 
 int CDECL _vcomp_sections_next(void)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_task_data *task_data = thread_data->task;
-    int i = -1;
+    LONG64 state;
 
     TRACE("()\n");
 
-    EnterCriticalSection(&vcomp_section);
-    if (thread_data->section == task_data->section &&
-        task_data->section_index != task_data->num_sections)
+    while (get_construct_state(&task_data->section_state, &task_data->section, thread_data->section, &state))
     {
-        i = task_data->section_index++;
+        unsigned int remaining = VCOMP_STATE_REMAINING(state);
+        int i = task_data->num_sections - remaining;
+        if (!remaining) break;
+        if (InterlockedCompareExchange64(&task_data->section_state,
+                                         VCOMP_STATE(thread_data->section, remaining - 1), state) == state)
+            return i;
     }
-    LeaveCriticalSection(&vcomp_section);
-    return i;
+    return -1;
 }
 
 void CDECL _vcomp_for_static_simple_init(unsigned int first, unsigned int last, int step,
@@ -1467,19 +1520,17 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
             type = VCOMP_DYNAMIC_FLAGS_GUIDED;
         }
 
-        EnterCriticalSection(&vcomp_section);
         thread_data->dynamic++;
         thread_data->dynamic_type = type;
-        if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
+        if (claim_construct(&task_data->dynamic, thread_data->dynamic))
         {
-            task_data->dynamic              = thread_data->dynamic;
             task_data->dynamic_first        = first;
             task_data->dynamic_last         = last;
             task_data->dynamic_iterations   = iterations;
             task_data->dynamic_step         = step;
             task_data->dynamic_chunksize    = chunksize;
+            publish_state(&task_data->dynamic_state, VCOMP_STATE(thread_data->dynamic, iterations));
         }
-        LeaveCriticalSection(&vcomp_section);
     }
 }
 
@@ -1502,26 +1553,35 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
+        unsigned int iterations, remaining, first, last;
+        LONG64 state;
+
+        while (get_construct_state(&task_data->dynamic_state, &task_data->dynamic, thread_data->dynamic, &state))
         {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+            if (!(remaining = VCOMP_STATE_REMAINING(state))) break;
+
+            iterations = min(remaining, task_data->dynamic_chunksize);
             if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+                remaining > num_threads * task_data->dynamic_chunksize)
+            {
+                iterations = (remaining + num_threads - 1) / num_threads;
+            }
+            first = task_data->dynamic_first + (task_data->dynamic_iterations - remaining) * task_data->dynamic_step;
+            last  = iterations == remaining ? task_data->dynamic_last
+                                            : first + (iterations - 1) * task_data->dynamic_step;
+
+            /* the construct may be reinitialized once the last chunk is taken,
+             * so everything has to be read before the state is updated */
+            if (InterlockedCompareExchange64(&task_data->dynamic_state,
+                                             VCOMP_STATE(thread_data->dynamic, remaining - iterations),
+                                             state) == state)
             {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+                *begin = first;
+                *end   = last;
+                return 1;
             }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
-                *end = task_data->dynamic_last;
         }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+        return 0;
     }
 
     return 0;
@@ -1551,8 +1611,10 @@ static DWORD WINAPI _vcomp_fork_worker(void *param)
             EnterCriticalSection(&vcomp_section);
 
             thread_data->team = NULL;
+            /* reuse the most recently active threads first, so that their caches are
+             * still warm and surplus threads can time out */
             list_remove(&thread_data->entry);
-            list_add_tail(&vcomp_idle_threads, &thread_data->entry);
+            list_add_head(&vcomp_idle_threads, &thread_data->entry);
             if (++team->finished_threads >= team->num_threads)
                 WakeAllConditionVariable(&team->cond);
         }
@@ -1606,6 +1668,8 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     task_data.single            = 0;
     task_data.section           = 0;
     task_data.dynamic           = 0;
+    task_data.section_state     = 0;
+    task_data.dynamic_state     = 0;
 
     thread_data.team            = &team_data;
     thread_data.task            = &task_data;
@@ -601,6 +601,39 @@ static void test_vcomp_fork(void)
     pomp_set_num_threads(max_threads);
 }
 
+static void CDECL barrier_cb(LONG *count)
+{
+    int num_threads = pomp_get_num_threads();
+    LONG value;
+    int i;
+
+    for (i = 0; i < 100; i++)
+    {
+        InterlockedIncrement(count);
+        p_vcomp_barrier();
+        value = *count;
+        ok(value == num_threads * (i + 1), "expected count == %d, got %d\n", num_threads * (i + 1), value);
+        p_vcomp_barrier();
+    }
+}
+
+static void test_vcomp_barrier(void)
+{
+    int max_threads = pomp_get_max_threads();
+    LONG count;
+    int i;
+
+    for (i = 1; i <= 16; i *= 2)
+    {
+        pomp_set_num_threads(i);
+        count = 0;
+        p_vcomp_fork(TRUE, 1, barrier_cb, &count);
+        ok(count == i * 100, "expected count == %d, got %d\n", i * 100, count);
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
 static void CDECL section_cb(LONG *a, LONG *b, LONG *c)
 {
     int i;
@@ -2640,6 +2673,7 @@ START_TEST(vcomp)
     test_omp_get_num_threads(FALSE);
     test_omp_get_num_threads(TRUE);
     test_vcomp_fork();
+    test_vcomp_barrier();
     test_vcomp_sections_init();
     test_vcomp_for_static_simple_init();
     test_vcomp_for_static_init();
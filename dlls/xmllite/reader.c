@@ -198,7 +198,8 @@ static const struct IUnknownVtbl xmlreaderinputvtbl;
 /* Structure to hold parsed string of specific length.
 
    Reader stores node value as 'start' pointer, on request
-   a null-terminated version of it is allocated.
+   a null-terminated version of it is allocated. Names are not
+   allocated per node, they point to the reader name table instead.
 
    To init a strval variable use reader_init_strval(),
    to set strval as a reader value use reader_set_strval().
@@ -208,6 +209,7 @@ typedef struct
     WCHAR *str;   /* allocated null-terminated string */
     UINT   len;   /* length in WCHARs, altered after ReadValueChunk */
     UINT   start; /* input position where value starts */
+    BOOL   interned; /* str is owned by the name table */
 } strval;
 
 static WCHAR emptyW[] = L"";
@@ -257,6 +259,14 @@ struct ns
     struct element *element;
 };
 
+struct name_entry
+{
+    struct name_entry *next;
+    UINT hash;
+    UINT len;
+    WCHAR str[1];
+};
+
 typedef struct
 {
     IXmlReader IXmlReader_iface;
@@ -278,6 +288,11 @@ typedef struct
     struct list nsdef;
     struct list ns;
     struct list elements;
+    struct list free_attrs; /* released attribute and element structures, reused */
+    struct list free_elements;
+    struct name_entry **names; /* hash table of interned names */
+    UINT names_size;
+    UINT names_count;
     int chunk_read_off;
     strval strvalues[StringValue_Last];
     UINT depth;
@@ -348,11 +363,114 @@ static HRESULT reader_strvaldup(xmlreader *reader, const strval *src, strval *de
         memcpy(dest->str, reader_get_strptr(reader, src), dest->len*sizeof(WCHAR));
         dest->str[dest->len] = 0;
         dest->start = 0;
+        dest->interned = FALSE;
+    }
+
+    return S_OK;
+}
+
+static inline UINT reader_hash_name(const WCHAR *str, UINT len)
+{
+    UINT hash = 0;
+
+    while (len--)
+        hash = hash * 31 + *str++;
+
+    return hash;
+}
+
+static BOOL reader_grow_names(xmlreader *reader)
+{
+    UINT size = reader->names_size ? reader->names_size * 2 : 64, i;
+    struct name_entry **names, *entry, *next;
+
+    if (!(names = reader_alloc_zero(reader, size * sizeof(*names))))
+        return FALSE;
+
+    for (i = 0; i < reader->names_size; i++)
+    {
+        for (entry = reader->names[i]; entry; entry = next)
+        {
+            next = entry->next;
+            entry->next = names[entry->hash & (size - 1)];
+            names[entry->hash & (size - 1)] = entry;
+        }
+    }
+
+    reader_free(reader, reader->names);
+    reader->names = names;
+    reader->names_size = size;
+    return TRUE;
+}
+
+/* Names repeat a lot in a document, so instead of allocating a copy for every
+   node they are looked up in a table and shared until the parser is reset. */
+static HRESULT reader_intern_name(xmlreader *reader, const strval *src, strval *dest)
+{
+    struct name_entry *entry;
+    const WCHAR *str;
+    UINT hash;
+
+    if (!src->len)
+    {
+        *dest = strval_empty;
+        return S_OK;
+    }
+
+    str = reader_get_strptr(reader, src);
+    hash = reader_hash_name(str, src->len);
+
+    if (reader->names_size)
+    {
+        for (entry = reader->names[hash & (reader->names_size - 1)]; entry; entry = entry->next)
+        {
+            if (entry->hash == hash && entry->len == src->len && !memcmp(entry->str, str, src->len * sizeof(WCHAR)))
+                goto done;
+        }
     }
 
+    if (reader->names_count >= reader->names_size && !reader_grow_names(reader))
+        return E_OUTOFMEMORY;
+
+    if (!(entry = reader_alloc(reader, FIELD_OFFSET(struct name_entry, str[src->len + 1]))))
+        return E_OUTOFMEMORY;
+
+    entry->hash = hash;
+    entry->len = src->len;
+    memcpy(entry->str, str, src->len * sizeof(WCHAR));
+    entry->str[src->len] = 0;
+    entry->next = reader->names[hash & (reader->names_size - 1)];
+    reader->names[hash & (reader->names_size - 1)] = entry;
+    reader->names_count++;
+
+done:
+    dest->str = entry->str;
+    dest->len = entry->len;
+    dest->start = 0;
+    dest->interned = TRUE;
     return S_OK;
 }
 
+static void reader_clear_names(xmlreader *reader)
+{
+    struct name_entry *entry, *next;
+    UINT i;
+
+    for (i = 0; i < reader->names_size; i++)
+    {
+        for (entry = reader->names[i]; entry; entry = next)
+        {
+            next = entry->next;
+            reader_free(reader, entry);
+        }
+    }
+
+    reader_free(reader, reader->names);
+    reader->names = NULL;
+    reader->names_size = 0;
+    reader->names_count = 0;
+}
+
 /* reader input memory allocation functions */
 static inline void *readerinput_alloc(xmlreaderinput *input, size_t len)
 {
@@ -389,46 +507,55 @@ static void reader_free_strvalued(xmlreader *reader, strval *v)
 {
     if (v->str != strval_empty.str)
     {
-        reader_free(reader, v->str);
+        if (!v->interned)
+            reader_free(reader, v->str);
         *v = strval_empty;
     }
 }
 
 static void reader_clear_attrs(xmlreader *reader)
 {
-    struct attribute *attr, *attr2;
-    LIST_FOR_EACH_ENTRY_SAFE(attr, attr2, &reader->attrs, struct attribute, entry)
+    struct attribute *attr;
+
+    LIST_FOR_EACH_ENTRY(attr, &reader->attrs, struct attribute, entry)
     {
         reader_free_strvalued(reader, &attr->localname);
         reader_free_strvalued(reader, &attr->value);
-        reader_free(reader, attr);
     }
-    list_init(&reader->attrs);
+    list_move_tail(&reader->free_attrs, &reader->attrs);
     reader->attr_count = 0;
     reader->attr = NULL;
 }
 
 /* attribute data holds pointers to buffer data, so buffer shrink is not possible
-   while we are on a node with attributes */
+   while we are on a node with attributes; the value is only copied when requested */
 static HRESULT reader_add_attr(xmlreader *reader, strval *prefix, strval *localname, strval *qname,
     strval *value, const struct reader_position *position, unsigned int flags)
 {
+    struct list *entry;
     struct attribute *attr;
     HRESULT hr;
 
-    attr = reader_alloc(reader, sizeof(*attr));
-    if (!attr) return E_OUTOFMEMORY;
+    if ((entry = list_head(&reader->free_attrs)))
+    {
+        list_remove(entry);
+        attr = LIST_ENTRY(entry, struct attribute, entry);
+    }
+    else if (!(attr = reader_alloc(reader, sizeof(*attr))))
+        return E_OUTOFMEMORY;
 
-    hr = reader_strvaldup(reader, localname, &attr->localname);
+    hr = reader_intern_name(reader, localname, &attr->localname);
     if (hr == S_OK)
     {
-        hr = reader_strvaldup(reader, value, &attr->value);
-        if (hr != S_OK)
-            reader_free_strvalued(reader, &attr->value);
+        if (value->str)
+            hr = reader_strvaldup(reader, value, &attr->value);
+        else
+            attr->value = *value;
     }
     if (hr != S_OK)
     {
-        reader_free(reader, attr);
+        reader_free_strvalued(reader, &attr->localname);
+        list_add_head(&reader->free_attrs, &attr->entry);
         return hr;
     }
 
@@ -459,6 +586,7 @@ static inline void reader_init_strvalue(UINT start, UINT len, strval *v)
     v->start = start;
     v->len = len;
     v->str = NULL;
+    v->interned = FALSE;
 }
 
 static inline const char* debug_strval(const xmlreader *reader, const strval *v)
@@ -472,6 +600,7 @@ static inline void reader_init_cstrvalue(WCHAR *str, UINT len, strval *v)
     v->start = 0;
     v->len = len;
     v->str = str;
+    v->interned = FALSE;
 }
 
 static void reader_free_strvalue(xmlreader *reader, XmlReaderStringValue type)
@@ -496,15 +625,15 @@ static inline int strval_eq(const xmlreader *reader, const strval *str1, const s
 
 static void reader_clear_elements(xmlreader *reader)
 {
-    struct element *elem, *elem2;
-    LIST_FOR_EACH_ENTRY_SAFE(elem, elem2, &reader->elements, struct element, entry)
+    struct element *elem;
+
+    LIST_FOR_EACH_ENTRY(elem, &reader->elements, struct element, entry)
     {
         reader_free_strvalued(reader, &elem->prefix);
         reader_free_strvalued(reader, &elem->localname);
         reader_free_strvalued(reader, &elem->qname);
-        reader_free(reader, elem);
     }
-    list_init(&reader->elements);
+    list_move_tail(&reader->free_elements, &reader->elements);
     reader_free_strvalued(reader, &reader->empty_element.localname);
     reader_free_strvalued(reader, &reader->empty_element.qname);
     reader->is_empty_element = FALSE;
@@ -545,7 +674,7 @@ static HRESULT reader_push_ns(xmlreader *reader, const strval *prefix, const str
     if (def)
         memset(&ns->prefix, 0, sizeof(ns->prefix));
     else {
-        hr = reader_strvaldup(reader, prefix, &ns->prefix);
+        hr = reader_intern_name(reader, prefix, &ns->prefix);
         if (FAILED(hr)) {
             reader_free(reader, ns);
             return hr;
@@ -569,7 +698,7 @@ static void reader_free_element(xmlreader *reader, struct element *element)
     reader_free_strvalued(reader, &element->prefix);
     reader_free_strvalued(reader, &element->localname);
     reader_free_strvalued(reader, &element->qname);
-    reader_free(reader, element);
+    list_add_head(&reader->free_elements, &element->entry);
 }
 
 static void reader_mark_ns_nodes(xmlreader *reader, struct element *element)
@@ -592,16 +721,22 @@ static void reader_mark_ns_nodes(xmlreader *reader, struct element *element)
 static HRESULT reader_push_element(xmlreader *reader, strval *prefix, strval *localname,
     strval *qname, const struct reader_position *position)
 {
+    struct list *entry;
     struct element *element;
     HRESULT hr;
 
-    element = reader_alloc_zero(reader, sizeof(*element));
-    if (!element)
+    if ((entry = list_head(&reader->free_elements)))
+    {
+        list_remove(entry);
+        element = LIST_ENTRY(entry, struct element, entry);
+        memset(element, 0, sizeof(*element));
+    }
+    else if (!(element = reader_alloc_zero(reader, sizeof(*element))))
         return E_OUTOFMEMORY;
 
-    if ((hr = reader_strvaldup(reader, prefix, &element->prefix)) == S_OK &&
-            (hr = reader_strvaldup(reader, localname, &element->localname)) == S_OK &&
-            (hr = reader_strvaldup(reader, qname, &element->qname)) == S_OK)
+    if ((hr = reader_intern_name(reader, prefix, &element->prefix)) == S_OK &&
+            (hr = reader_intern_name(reader, localname, &element->localname)) == S_OK &&
+            (hr = reader_intern_name(reader, qname, &element->qname)) == S_OK)
     {
         list_add_head(&reader->elements, &element->entry);
         reader_mark_ns_nodes(reader, element);
@@ -657,8 +792,8 @@ static void reader_pop_element(xmlreader *reader)
         reader->instate = XmlReadInState_MiscEnd;
 }
 
-/* Always make a copy, cause strings are supposed to be null terminated. Null pointer for 'value'
-   means node value is to be determined. */
+/* Always make a copy or use an interned name, cause strings are supposed to be null terminated.
+   Null pointer for 'value' means node value is to be determined. */
 static void reader_set_strvalue(xmlreader *reader, XmlReaderStringValue type, const strval *value)
 {
     strval *v = &reader->strvalues[type];
@@ -684,12 +819,7 @@ static void reader_set_strvalue(xmlreader *reader, XmlReaderStringValue type, co
             v->len = value->len;
         }
         else
-        {
-            v->str = reader_alloc(reader, (value->len + 1)*sizeof(WCHAR));
-            memcpy(v->str, reader_get_strptr(reader, value), value->len*sizeof(WCHAR));
-            v->str[value->len] = 0;
-            v->len = value->len;
-        }
+            reader_intern_name(reader, value, v);
     }
 }
 
@@ -1050,6 +1180,9 @@ static void reader_shrink(xmlreader *reader)
 {
     encoded_buffer *buffer = &reader->input->buffer->utf16;
 
+    /* attribute values still point to the buffer */
+    if (reader->attr_count) return;
+
     /* avoid to move too often using threshold shrink length */
     if (buffer->cur*sizeof(WCHAR) > buffer->written / 2)
     {
@@ -1164,6 +1297,24 @@ static inline BOOL is_wchar_space(WCHAR ch)
     return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
 }
 
+/* Moves cursor over already converted data up to the next stop character or
+   to the end of the buffer, at least one character is skipped. This avoids
+   going through reader_get_ptr() for every character of long text runs. */
+static WCHAR *reader_skip_run(xmlreader *reader, WCHAR stop1, WCHAR stop2, WCHAR stop3)
+{
+    encoded_buffer *buffer = &reader->input->buffer->utf16;
+    WCHAR *start = (WCHAR *)buffer->data + buffer->cur, *ptr = start;
+
+    do
+    {
+        reader_update_position(reader, *ptr);
+        ptr++;
+    } while (*ptr && *ptr != stop1 && *ptr != stop2 && *ptr != stop3);
+
+    buffer->cur += ptr - start;
+    return ptr;
+}
+
 /* [3] S ::= (#x20 | #x9 | #xD | #xA)+ */
 static int reader_skipspaces(xmlreader *reader)
 {
@@ -1464,8 +1615,7 @@ static HRESULT reader_parse_comment(xmlreader *reader)
             }
         }
 
-        reader_skipn(reader, 1);
-        ptr++;
+        ptr = reader_skip_run(reader, '-', '-', '-');
     }
 
     return S_OK;
@@ -2201,9 +2351,11 @@ static HRESULT reader_parse_attvalue(xmlreader *reader, strval *value)
         }
         else
         {
+            WCHAR *end = reader_skip_run(reader, quote, '<', '&');
+
             /* replace all whitespace chars with ' ' */
-            if (is_wchar_space(*ptr)) *ptr = ' ';
-            reader_skipn(reader, 1);
+            for (; ptr < end; ptr++)
+                if (is_wchar_space(*ptr)) *ptr = ' ';
         }
         ptr = reader_get_ptr(reader);
     }
@@ -2270,8 +2422,8 @@ static HRESULT reader_parse_stag(xmlreader *reader, strval *prefix, strval *loca
             reader_free_strvalued(reader, &element->localname);
 
             element->prefix = *prefix;
-            reader_strvaldup(reader, qname, &element->qname);
-            reader_strvaldup(reader, local, &element->localname);
+            reader_intern_name(reader, qname, &element->qname);
+            reader_intern_name(reader, local, &element->localname);
             element->position = position;
             reader_mark_ns_nodes(reader, element);
             return S_OK;
@@ -2421,7 +2573,7 @@ static HRESULT reader_parse_cdata(xmlreader *reader)
         }
         else
         {
-            reader_skipn(reader, 1);
+            reader_skip_run(reader, ']', ']', ']');
             ptr = reader_get_ptr(reader);
         }
     }
@@ -2474,13 +2626,19 @@ static HRESULT reader_parse_chardata(xmlreader *reader)
             return S_OK;
         }
 
-        /* this covers a case when text has leading whitespace chars */
-        if (!is_wchar_space(*ptr)) reader->nodetype = XmlNodeType_Text;
-
-        if (!reader_cmp(reader, L"&"))
+        if (*ptr == '&')
+        {
+            /* this covers a case when text has leading whitespace chars */
+            reader->nodetype = XmlNodeType_Text;
             reader_parse_reference(reader);
+        }
         else
-            reader_skipn(reader, 1);
+        {
+            WCHAR *end = reader_skip_run(reader, '<', '&', ']');
+
+            for (; reader->nodetype == XmlNodeType_Whitespace && ptr < end; ptr++)
+                if (!is_wchar_space(*ptr)) reader->nodetype = XmlNodeType_Text;
+        }
 
         ptr = reader_get_ptr(reader);
     }
@@ -2712,6 +2870,7 @@ static void reader_reset_parser(xmlreader *reader)
     reader_clear_attrs(reader);
     reader_clear_ns(reader);
     reader_free_strvalues(reader);
+    reader_clear_names(reader);
 
     reader->depth = 0;
     reader->nodetype = XmlNodeType_None;
@@ -2730,7 +2889,14 @@ static ULONG WINAPI xmlreader_Release(IXmlReader *iface)
     if (ref == 0)
     {
         IMalloc *imalloc = This->imalloc;
+        struct attribute *attr, *attr2;
+        struct element *elem, *elem2;
+
         reader_reset_parser(This);
+        LIST_FOR_EACH_ENTRY_SAFE(attr, attr2, &This->free_attrs, struct attribute, entry)
+            reader_free(This, attr);
+        LIST_FOR_EACH_ENTRY_SAFE(elem, elem2, &This->free_elements, struct element, entry)
+            reader_free(This, elem);
         if (This->input) IUnknown_Release(&This->input->IXmlReaderInput_iface);
         if (This->resolver) IXmlResolver_Release(This->resolver);
         if (This->mlang) IUnknown_Release(This->mlang);
@@ -3341,12 +3507,13 @@ static const strval *reader_get_value(xmlreader *reader, BOOL ensure_allocated)
 
             return &ns->uri;
         }
-        return &reader->attr->value;
+        val = &reader->attr->value;
+        break;
     default:
+        val = &reader->strvalues[StringValue_Value];
         break;
     }
 
-    val = &reader->strvalues[StringValue_Value];
     if (!val->str && ensure_allocated)
     {
         WCHAR *ptr = reader_alloc(reader, (val->len+1)*sizeof(WCHAR));
@@ -3653,6 +3820,8 @@ HRESULT WINAPI CreateXmlReader(REFIID riid, void **obj, IMalloc *imalloc)
     list_init(&reader->nsdef);
     list_init(&reader->ns);
     list_init(&reader->elements);
+    list_init(&reader->free_attrs);
+    list_init(&reader->free_elements);
     reader->max_depth = 256;
 
     reader->chunk_read_off = 0;
@@ -2514,7 +2514,7 @@ static void test_string_pointers(void)
     ok(empty == reader_value(reader, L""), "empty != value\n");
     ok(empty == reader_prefix(reader, L""), "empty != prefix\n");
     xml = reader_name(reader, L"xml");
-    ptr = reader_qname(reader, L"xml"); todo_wine ok(xml == ptr, "xml != qname\n");
+    ptr = reader_qname(reader, L"xml"); ok(xml == ptr, "xml != qname\n");
     ok(empty == reader_namespace(reader, L""), "empty != namespace\n");
 
     next_attribute(reader);
@@ -2631,6 +2631,54 @@ static void test_attribute_by_name(void)
     IXmlReader_Release(reader);
 }
 
+static void test_read_long_document(void)
+{
+    static const char item[] = "<item id=\"1\" v=\"x&amp;\ty\">text &lt; more</item>";
+    IXmlReader *reader;
+    char *xml, *ptr;
+    HRESULT hr;
+    int i;
+
+    /* long enough to be read in several chunks */
+    ptr = xml = heap_alloc(sizeof(item) * 1000 + 16);
+    ptr += sprintf(ptr, "<a>");
+    for (i = 0; i < 1000; i++)
+        ptr += sprintf(ptr, "%s", item);
+    sprintf(ptr, "</a>");
+
+    hr = CreateXmlReader(&IID_IXmlReader, (void **)&reader, NULL);
+    ok(hr == S_OK, "S_OK, got %08x\n", hr);
+
+    set_input_string(reader, xml);
+
+    read_node(reader, XmlNodeType_Element);
+    reader_name(reader, L"a");
+
+    for (i = 0; i < 1000; i++)
+    {
+        read_node(reader, XmlNodeType_Element);
+        reader_name(reader, L"item");
+        next_attribute(reader);
+        reader_name(reader, L"id");
+        reader_value(reader, L"1");
+        next_attribute(reader);
+        reader_name(reader, L"v");
+        reader_value(reader, L"x& y");
+
+        read_node(reader, XmlNodeType_Text);
+        reader_value(reader, L"text < more");
+
+        read_node(reader, XmlNodeType_EndElement);
+        reader_name(reader, L"item");
+    }
+
+    read_node(reader, XmlNodeType_EndElement);
+    reader_name(reader, L"a");
+
+    IXmlReader_Release(reader);
+    heap_free(xml);
+}
+
 START_TEST(reader)
 {
     test_reader_create();
@@ -2659,4 +2707,5 @@ START_TEST(reader)
     test_reader_position();
     test_string_pointers();
     test_attribute_by_name();
+    test_read_long_document();
 }
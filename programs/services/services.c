@@ -47,6 +47,7 @@ DWORD service_kill_timeout = 60000;
 static DWORD default_preshutdown_timeout = 180000;
 static DWORD autostart_delay = 120000;
 static void *environment = NULL;
+static INIT_ONCE environment_once = INIT_ONCE_STATIC_INIT;
 static HKEY service_current_key = NULL;
 
 static const BOOL is_win64 = (sizeof(void *) > sizeof(int));
@@ -441,6 +442,158 @@ static BOOL is_root_pnp_service(HDEVINFO set, const struct service_entry *servic
     return FALSE;
 }
 
+/* maximum number of services started concurrently during autostart */
+#define AUTOSTART_MAX_THREADS 8
+
+struct autostart_context;
+
+struct autostart_item
+{
+    struct autostart_context *ctx;
+    struct service_entry *service;
+    unsigned int pending;   /* number of dependencies that are not started yet */
+    BOOL queued;
+};
+
+struct autostart_context
+{
+    CRITICAL_SECTION cs;
+    TP_CALLBACK_ENVIRON environment;
+    PTP_CLEANUP_GROUP cleanup;
+    HANDLE done_event;
+    unsigned int running;   /* number of queued services that are not started yet */
+    unsigned int count;
+    struct autostart_item items[1];
+};
+
+static BOOL service_depends_on(const struct service_entry *service, const struct service_entry *dependency)
+{
+    const WCHAR *group = dependency->config.lpLoadOrderGroup;
+    const WCHAR *ptr;
+
+    if (service == dependency) return FALSE;
+
+    for (ptr = service->dependOnServices; *ptr; ptr += lstrlenW(ptr) + 1)
+        if (!wcsicmp(ptr, dependency->name)) return TRUE;
+
+    if (!group || !group[0]) return FALSE;
+    for (ptr = service->dependOnGroups; *ptr; ptr += lstrlenW(ptr) + 1)
+        if (!wcsicmp(ptr, group)) return TRUE;
+
+    return FALSE;
+}
+
+static void autostart_queue(struct autostart_item *item);
+
+static void CALLBACK autostart_callback(TP_CALLBACK_INSTANCE *instance, void *context)
+{
+    struct autostart_item *item = context, *dependent;
+    struct autostart_context *ctx = item->ctx;
+    ULONGLONG start = GetTickCount64();
+    unsigned int i;
+    DWORD err;
+
+    err = service_start(item->service, 0, NULL);
+    if (err != ERROR_SUCCESS)
+        WINE_FIXME("Auto-start service %s failed to start: %d\n",
+                   wine_dbgstr_w(item->service->name), err);
+    else
+        TRACE("started %s in %u ms\n", wine_dbgstr_w(item->service->name),
+              (DWORD)(GetTickCount64() - start));
+
+    EnterCriticalSection(&ctx->cs);
+    for (i = 0; i < ctx->count; i++)
+    {
+        dependent = &ctx->items[i];
+        if (dependent->queued || !service_depends_on(dependent->service, item->service)) continue;
+        if (!--dependent->pending) autostart_queue(dependent);
+    }
+    if (!--ctx->running) SetEvent(ctx->done_event);
+    LeaveCriticalSection(&ctx->cs);
+}
+
+/* caller must hold ctx->cs */
+static void autostart_queue(struct autostart_item *item)
+{
+    struct autostart_context *ctx = item->ctx;
+
+    if (!TrySubmitThreadpoolCallback(autostart_callback, item, &ctx->environment))
+    {
+        ERR("TrySubmitThreadpoolCallback failed with error %u\n", GetLastError());
+        return;
+    }
+    item->queued = TRUE;
+    ctx->running++;
+}
+
+/* Starts the given services on a bounded thread pool. A service is only
+ * started once all services and groups it depends on have been started. */
+static void autostart_services_parallel(struct service_entry **services, unsigned int count)
+{
+    struct autostart_context *ctx;
+    ULONGLONG start = GetTickCount64();
+    PTP_POOL pool;
+    unsigned int i, j;
+
+    if (!count) return;
+
+    if (!(ctx = heap_alloc_zero(FIELD_OFFSET(struct autostart_context, items[count]))) ||
+        !(ctx->done_event = CreateEventW(NULL, TRUE, FALSE, NULL)) ||
+        !(ctx->cleanup = CreateThreadpoolCleanupGroup()))
+    {
+        if (ctx && ctx->done_event) CloseHandle(ctx->done_event);
+        heap_free(ctx);
+        for (i = 0; i < count; i++)
+            service_start(services[i], 0, NULL);
+        return;
+    }
+
+    InitializeCriticalSection(&ctx->cs);
+    ctx->environment.Version = 1;
+    /* the callbacks still use ctx after signaling done_event */
+    ctx->environment.CleanupGroup = ctx->cleanup;
+    if ((pool = CreateThreadpool(NULL)))
+    {
+        SetThreadpoolThreadMaximum(pool, AUTOSTART_MAX_THREADS);
+        ctx->environment.Pool = pool;
+    }
+    ctx->count = count;
+
+    for (i = 0; i < count; i++)
+    {
+        ctx->items[i].ctx = ctx;
+        ctx->items[i].service = services[i];
+        for (j = 0; j < count; j++)
+            if (service_depends_on(services[i], services[j])) ctx->items[i].pending++;
+    }
+
+    EnterCriticalSection(&ctx->cs);
+    for (i = 0; i < count; i++)
+        if (!ctx->items[i].pending) autostart_queue(&ctx->items[i]);
+    if (!ctx->running) SetEvent(ctx->done_event);
+    LeaveCriticalSection(&ctx->cs);
+
+    WaitForSingleObject(ctx->done_event, INFINITE);
+    CloseThreadpoolCleanupGroupMembers(ctx->cleanup, FALSE, NULL);
+    CloseThreadpoolCleanupGroup(ctx->cleanup);
+
+    /* services left over have cyclic dependencies, start them in order */
+    for (i = 0; i < count; i++)
+    {
+        if (ctx->items[i].queued) continue;
+        WARN("starting %s with unresolved dependencies\n", wine_dbgstr_w(services[i]->name));
+        if (service_start(services[i], 0, NULL) != ERROR_SUCCESS)
+            WINE_FIXME("Auto-start service %s failed to start\n", wine_dbgstr_w(services[i]->name));
+    }
+
+    TRACE("started %u services in %u ms\n", count, (DWORD)(GetTickCount64() - start));
+
+    if (pool) CloseThreadpool(pool);
+    CloseHandle(ctx->done_event);
+    DeleteCriticalSection(&ctx->cs);
+    heap_free(ctx);
+}
+
 static void scmdatabase_autostart_services(struct scmdatabase *db)
 {
     static const WCHAR rootW[] = {'R','O','O','T',0};
@@ -448,6 +601,8 @@ static void scmdatabase_autostart_services(struct scmdatabase *db)
     unsigned int i = 0;
     unsigned int size = 32;
     unsigned int delayed_cnt = 0;
+    unsigned int parallel_cnt = 0;
+    struct service_entry **parallel_list;
     struct service_entry *service;
     HDEVINFO set;
 
@@ -485,6 +640,10 @@ static void scmdatabase_autostart_services(struct scmdatabase *db)
     qsort(services_list, size, sizeof(services_list[0]), compare_tags);
     scmdatabase_lock_startup(db, INFINITE);
 
+    parallel_list = heap_alloc(size * sizeof(parallel_list[0]));
+
+    /* drivers are started in tag order before any other service, the
+     * remaining services are started concurrently where dependencies allow */
     for (i = 0; i < size; i++)
     {
         DWORD err;
@@ -495,6 +654,11 @@ static void scmdatabase_autostart_services(struct scmdatabase *db)
             services_list[delayed_cnt++] = service;
             continue;
         }
+        if (parallel_list && !(service->config.dwServiceType & SERVICE_DRIVER))
+        {
+            parallel_list[parallel_cnt++] = service;
+            continue;
+        }
         err = service_start(service, 0, NULL);
         if (err != ERROR_SUCCESS)
             WINE_FIXME("Auto-start service %s failed to start: %d\n",
@@ -502,6 +666,11 @@ static void scmdatabase_autostart_services(struct scmdatabase *db)
         release_service(service);
     }
 
+    autostart_services_parallel(parallel_list, parallel_cnt);
+    for (i = 0; i < parallel_cnt; i++)
+        release_service(parallel_list[i]);
+    heap_free(parallel_list);
+
     scmdatabase_unlock_startup(db);
 
     if (!delayed_cnt || !schedule_delayed_autostart(services_list, delayed_cnt))
@@ -790,28 +959,30 @@ void service_unlock(struct service_entry *service)
     LeaveCriticalSection(&service->db->cs);
 }
 
-/* only one service started at a time, so there is no race on the registry
- * value here */
-static LPWSTR service_get_pipe_name(void)
+static const WCHAR pipe_name_format[] = { '\\','\\','.','\\','p','i','p','e','\\',
+    'n','e','t','\\','N','t','C','o','n','t','r','o','l','P','i','p','e','%','u',0};
+
+/* services may be started in parallel, the registry value is updated under the
+ * database lock */
+static void service_get_pipe_name(WCHAR *name, DWORD size)
 {
-    static const WCHAR format[] = { '\\','\\','.','\\','p','i','p','e','\\',
-        'n','e','t','\\','N','t','C','o','n','t','r','o','l','P','i','p','e','%','u',0};
-    static WCHAR name[ARRAY_SIZE(format) + 10]; /* lstrlenW("4294967295") */
-    static DWORD service_current = 0;
-    DWORD len, value = -1;
+    static LONG service_current = 0;
+    DWORD len, value = -1, current;
     LONG ret;
     DWORD type;
 
+    scmdatabase_lock(active_database);
     len = sizeof(value);
     ret = RegQueryValueExW(service_current_key, NULL, NULL, &type,
         (BYTE *)&value, &len);
-    if (ret == ERROR_SUCCESS && type == REG_DWORD)
-        service_current = max(service_current, value + 1);
+    if (ret == ERROR_SUCCESS && type == REG_DWORD && (LONG)(value + 1) > service_current)
+        InterlockedExchange(&service_current, value + 1);
+    current = InterlockedIncrement(&service_current) - 1;
     RegSetValueExW(service_current_key, NULL, 0, REG_DWORD,
-        (BYTE *)&service_current, sizeof(service_current));
-    swprintf(name, ARRAY_SIZE(name), format, service_current);
-    service_current++;
-    return name;
+        (BYTE *)&current, sizeof(current));
+    scmdatabase_unlock(active_database);
+
+    swprintf(name, size, pipe_name_format, current);
 }
 
 static DWORD get_service_binary_path(const struct service_entry *service_entry, WCHAR **path)
@@ -949,6 +1120,28 @@ error:
     return ERROR_NOT_ENOUGH_SERVER_MEMORY;
 }
 
+/* services may be started concurrently during autostart */
+static BOOL CALLBACK init_environment(INIT_ONCE *once, void *param, void **context)
+{
+    HANDLE token;
+    WCHAR val[16];
+
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY | TOKEN_DUPLICATE, &token))
+        return TRUE;
+
+    CreateEnvironmentBlock(&environment, token, FALSE);
+    if (GetEnvironmentVariableW( L"WINEBOOTSTRAPMODE", val, ARRAY_SIZE(val) ))
+    {
+        UNICODE_STRING name, value;
+
+        RtlInitUnicodeString( &name, L"WINEBOOTSTRAPMODE" );
+        RtlInitUnicodeString( &value, val );
+        RtlSetEnvironmentVariable( (WCHAR **)&environment, &name, &value );
+    }
+    CloseHandle(token);
+    return TRUE;
+}
+
 static DWORD service_start_process(struct service_entry *service_entry, struct process_entry **new_process,
                                    BOOL *shared_process)
 {
@@ -956,7 +1149,7 @@ static DWORD service_start_process(struct service_entry *service_entry, struct p
     PROCESS_INFORMATION pi;
     STARTUPINFOW si;
     BOOL is_wow64 = FALSE;
-    HANDLE token;
+    WCHAR pipe_name[ARRAY_SIZE(pipe_name_format) + 10]; /* lstrlenW("4294967295") */
     WCHAR *path;
     DWORD err;
     BOOL r;
@@ -1052,7 +1245,8 @@ found:
         return ERROR_SUCCESS;
     }
 
-    if ((err = process_create(service_get_pipe_name(), &process)))
+    service_get_pipe_name(pipe_name, ARRAY_SIZE(pipe_name));
+    if ((err = process_create(pipe_name, &process)))
     {
         WINE_ERR("failed to create process object for %s, error = %u\n",
                  wine_dbgstr_w(service_entry->name), err);
@@ -1069,20 +1263,7 @@ found:
         si.lpDesktop = desktopW;
     }
 
-    if (!environment && OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY | TOKEN_DUPLICATE, &token))
-    {
-        WCHAR val[16];
-        CreateEnvironmentBlock(&environment, token, FALSE);
-        if (GetEnvironmentVariableW( L"WINEBOOTSTRAPMODE", val, ARRAY_SIZE(val) ))
-        {
-            UNICODE_STRING name, value;
-
-            RtlInitUnicodeString( &name, L"WINEBOOTSTRAPMODE" );
-            RtlInitUnicodeString( &value, val );
-            RtlSetEnvironmentVariable( (WCHAR **)&environment, &name, &value );
-        }
-        CloseHandle(token);
-    }
+    InitOnceExecuteOnce(&environment_once, init_environment, NULL, NULL);
 
     service_entry->status.dwCurrentState = SERVICE_START_PENDING;
     service_entry->status.dwControlsAccepted = 0;